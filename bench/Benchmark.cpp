@@ -0,0 +1,123 @@
+#include "Benchmark.h"
+#include "Tokenizer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <exception>
+
+
+BenchRunner::BenchRunner(std::chrono::milliseconds minTime, std::string filter)
+    : m_minTime(minTime), m_filter(std::move(filter))
+{
+}
+
+void BenchRunner::measure(const std::string& group, const std::string& name, int param, const std::function<void()>& func,
+    std::size_t operationsPerCall)
+{
+    if (!m_filter.empty() && (group + '/' + name).find(m_filter) == std::string::npos)
+        return;
+
+    using Clock = std::chrono::steady_clock;
+    const auto run = [&func](std::size_t iterations)
+    {
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            func();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    // Doubles the iteration count until one repetition takes its share of the minimum time
+    const auto target = std::chrono::duration<double, std::nano>(m_minTime).count() / REPETITIONS;
+    std::size_t iterations = 1;
+    while (run(iterations) < target && iterations < (std::size_t(1) << 40))
+        iterations *= 2;
+
+    auto samples = std::vector<double>();
+    for (int i = 0; i < REPETITIONS; ++i)
+        samples.push_back(run(iterations) / static_cast<double>(iterations * operationsPerCall));
+    std::ranges::sort(samples);
+
+    const auto& result = m_results.emplace_back(BenchResult{ group, name, param, iterations, samples[REPETITIONS / 2] });
+    std::cerr << result.group << '/' << result.name << '/' << result.param << ": " << result.nsPerOp << " ns\n";
+}
+
+
+void writeJson(std::ostream& ostr, const std::vector<BenchResult>& results)
+{
+    ostr << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        ostr << "  {\"group\": \"" << result.group << "\", \"name\": \"" << result.name
+            << "\", \"param\": " << result.param << ", \"iterations\": " << result.iterations
+            << ", \"ns_per_op\": " << result.nsPerOp << '}' << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    ostr << "]\n";
+}
+
+void writeCsv(std::ostream& ostr, const std::vector<BenchResult>& results)
+{
+    ostr << "group,name,param,iterations,ns_per_op\n";
+    for (const auto& result : results)
+        ostr << result.group << ',' << result.name << ',' << result.param << ','
+            << result.iterations << ',' << result.nsPerOp << '\n';
+}
+
+std::vector<BenchResult> readCsv(std::istream& istr)
+{
+    auto results = std::vector<BenchResult>();
+    std::string line;
+    std::getline(istr, line); // header
+    while (std::getline(istr, line))
+    {
+        auto fields = std::vector<std::string>();
+        for (std::size_t start = 0; start <= line.size();)
+        {
+            const auto comma = std::min(line.find(',', start), line.size());
+            fields.push_back(line.substr(start, comma - start));
+            start = comma + 1;
+        }
+        if (fields.size() != 5)
+            continue;
+
+        const auto param = Tokenizer(fields[2]).nextInt();
+        try {
+            results.push_back({ fields[0], fields[1], param.value_or(0),
+                static_cast<std::size_t>(std::stoull(fields[3])), std::stod(fields[4]) });
+        }
+        catch (const std::exception&) {
+            // skip malformed lines
+        }
+    }
+    return results;
+}
+
+int compareWithBaseline(std::ostream& ostr, const std::vector<BenchResult>& results,
+    const std::vector<BenchResult>& baseline, double thresholdPercent)
+{
+    auto previous = std::map<std::tuple<std::string, std::string, int>, double>();
+    for (const auto& result : baseline)
+        previous[{ result.group, result.name, result.param }] = result.nsPerOp;
+
+    int regressions = 0;
+    for (const auto& result : results)
+    {
+        const auto it = previous.find({ result.group, result.name, result.param });
+        if (it == previous.end() || it->second <= 0)
+            continue;
+
+        const auto change = (result.nsPerOp / it->second - 1) * 100;
+        if (change > thresholdPercent)
+        {
+            ++regressions;
+            ostr << "REGRESSION ";
+        }
+        else
+            ostr << "ok         ";
+        ostr << result.group << '/' << result.name << '/' << result.param << ": "
+            << it->second << " -> " << result.nsPerOp << " ns (" << (change >= 0 ? "+" : "") << change << "%)\n";
+    }
+    return regressions;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <iosfwd>
+#include <chrono>
+#include <cstddef>
+
+
+// One measured case: the time of a single operation is the median over REPETITIONS runs
+struct BenchResult
+{
+    std::string group;
+    std::string name;
+    int param = 0; // matrix size, tree depth or script length
+    std::size_t iterations = 0;
+    double nsPerOp = 0;
+};
+
+// Keeps the compiler from discarding a value whose computation is being measured
+template <typename T>
+void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+class BenchRunner
+{
+public:
+    BenchRunner(std::chrono::milliseconds minTime, std::string filter);
+
+    // Measures func, which runs the operation operationsPerCall times per call,
+    // unless "group/name" is filtered out
+    void measure(const std::string& group, const std::string& name, int param, const std::function<void()>& func,
+        std::size_t operationsPerCall = 1);
+
+    const std::vector<BenchResult>& results() const { return m_results; }
+
+private:
+    static constexpr int REPETITIONS = 5;
+
+    std::chrono::milliseconds m_minTime;
+    std::string m_filter;
+    std::vector<BenchResult> m_results;
+};
+
+void writeJson(std::ostream& ostr, const std::vector<BenchResult>& results);
+void writeCsv(std::ostream& ostr, const std::vector<BenchResult>& results);
+// Reads what writeCsv() wrote
+std::vector<BenchResult> readCsv(std::istream& istr);
+
+// Prints every case slower than the baseline by more than thresholdPercent,
+// returns the number of such regressions
+int compareWithBaseline(std::ostream& ostr, const std::vector<BenchResult>& results,
+    const std::vector<BenchResult>& baseline, double thresholdPercent);
+
+void addMatrixBenchmarks(BenchRunner& runner);
+void addTreeBenchmarks(BenchRunner& runner);
+void addScriptBenchmarks(BenchRunner& runner);
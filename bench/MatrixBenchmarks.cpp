@@ -0,0 +1,96 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+
+#include <sstream>
+#include <random>
+#include <vector>
+#include <optional>
+
+namespace
+{
+    constexpr int SIZES[] = { 2, 5, 32, 128, 512 };
+
+    std::vector<int> randomValues(std::size_t count, std::mt19937& random)
+    {
+        // Small values, so that sums and small scales stay inside the allowed range
+        auto distribution = std::uniform_int_distribution<int>(MIN_ALLOWED_VALUE / 4, MAX_ALLOWED_VALUE / 4);
+        auto values = std::vector<int>(count);
+        for (auto& value : values)
+            value = distribution(random);
+        return values;
+    }
+
+    // Values with about half the non-zeros the sparse load density allows, at random positions
+    std::vector<int> sparseValues(std::size_t count, std::mt19937& random)
+    {
+        auto values = std::vector<int>(count);
+        auto position = std::uniform_int_distribution<std::size_t>(0, count - 1);
+        auto value = std::uniform_int_distribution<int>(1, MAX_ALLOWED_VALUE / 4);
+        const auto nonZeros = static_cast<std::size_t>(SPARSE_LOAD_DENSITY / 2 * static_cast<double>(count));
+        for (std::size_t i = 0; i < nonZeros; ++i)
+            values[position(random)] = value(random);
+        return values;
+    }
+
+    SquareMatrix<int> matrixOf(int size, const std::vector<int>& values)
+    {
+        auto matrix = SquareMatrix<int>(size);
+        std::size_t next = 0;
+        [[maybe_unused]] const auto parsed = tryParseMatrix([&] { return std::optional<int>(values[next++]); }, matrix);
+        return matrix;
+    }
+}
+
+
+void addMatrixBenchmarks(BenchRunner& runner)
+{
+    auto random = std::mt19937(42);
+    for (const int size : SIZES)
+    {
+        const auto count = static_cast<std::size_t>(size) * static_cast<std::size_t>(size);
+        const auto values = randomValues(count, random);
+        const auto a = matrixOf(size, values);
+        const auto b = matrixOf(size, randomValues(count, random));
+        const auto bTransposed = b.Transpose();
+
+        runner.measure("matrix", "add", size, [&] { doNotOptimize(a.tryAdd(b)); });
+        runner.measure("matrix", "sub", size, [&] { doNotOptimize(a.trySub(b)); });
+        runner.measure("matrix", "add_transposed", size, [&] { doNotOptimize(a.tryAdd(bTransposed)); });
+        runner.measure("matrix", "scale", size, [&] { doNotOptimize(a.tryScale(2)); });
+        runner.measure("matrix", "transpose", size, [&] { doNotOptimize(a.Transpose()); });
+
+        runner.measure("matrix", "parse", size, [&]
+            {
+                auto matrix = SquareMatrix<int>(size);
+                std::size_t next = 0;
+                doNotOptimize(tryParseMatrix([&] { return std::optional<int>(values[next++]); }, matrix));
+            });
+
+        // Input whose last element is out of range, so every element is checked and then rejected
+        auto invalid = values;
+        invalid.back() = MAX_ALLOWED_VALUE + 1;
+        runner.measure("matrix", "validate", size, [&]
+            {
+                auto matrix = SquareMatrix<int>(size);
+                std::size_t next = 0;
+                doNotOptimize(tryParseMatrix([&] { return std::optional<int>(invalid[next++]); }, matrix));
+            });
+
+        auto output = std::ostringstream();
+        runner.measure("matrix", "print", size, [&]
+            {
+                output.str({});
+                output << a;
+            });
+
+        // Parsed matrices this sparse are stored as CSR, so these run the merge, transpose and scale of CsrMatrix
+        if (size < SPARSE_MIN_SIZE)
+            continue;
+        const auto sparseA = matrixOf(size, sparseValues(count, random));
+        const auto sparseB = matrixOf(size, sparseValues(count, random));
+        runner.measure("matrix", "sparse_add", size, [&] { doNotOptimize(sparseA.tryAdd(sparseB)); });
+        runner.measure("matrix", "sparse_sub", size, [&] { doNotOptimize(sparseA.trySub(sparseB)); });
+        runner.measure("matrix", "sparse_scale", size, [&] { doNotOptimize(sparseA.tryScale(2)); });
+        runner.measure("matrix", "sparse_transpose", size, [&] { doNotOptimize(sparseA.Transpose()); });
+    }
+}
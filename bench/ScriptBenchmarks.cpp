@@ -0,0 +1,113 @@
+#include "Benchmark.h"
+#include "FunctionCalculator.h"
+#include "ScriptEngine.h"
+#include "SquareMatrix.h"
+
+#include <sstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int FUNCTIONS = 1000;
+    constexpr int EVALS = 1000;
+    constexpr int SPARSE_EVALS = 100;
+
+    // Builds FUNCTIONS functions from the built-in ones and from each other
+    void appendDefinitions(std::ostringstream& script, std::mt19937& random)
+    {
+        const char* kinds[] = { "add", "sub", "comp" };
+        for (int i = 0; i < FUNCTIONS; ++i)
+        {
+            const auto existing = std::uniform_int_distribution<int>(0, i + 1)(random);
+            if (i % 4 == 0)
+                script << "scal " << std::uniform_int_distribution<int>(-3, 3)(random) << '\n';
+            else
+                script << kinds[i % 3] << ' ' << existing << ' ' << (i + 1) / 2 << '\n';
+        }
+    }
+
+    // Evaluates the first functions, whose small trees keep the cost per command realistic
+    void appendEvals(std::ostringstream& script, std::mt19937& random, int functions)
+    {
+        for (int i = 0; i < EVALS; ++i)
+        {
+            const auto id = std::uniform_int_distribution<int>(0, std::min(functions, 40) + 1)(random);
+            script << "eval " << id << ' ' << MAX_MAT_SIZE << '\n';
+        }
+    }
+
+    void measureScript(BenchRunner& runner, const std::string& name, const std::string& script, int commands)
+    {
+        auto output = std::ostringstream();
+        auto errors = std::ostringstream();
+        runner.measure("script", name, commands, [&]
+            {
+                auto input = std::istringstream();
+                auto calculator = FunctionCalculator(input, output);
+                calculator.setMaxFunctions(FunctionCalculator::MAX_FUNCTIONS_LIMIT);
+                calculator.setMaxMatrixSize(SPARSE_MIN_SIZE);
+                auto engine = ScriptEngine(calculator, ErrorPolicy::Skip, errors);
+                doNotOptimize(engine.runText(script));
+                output.str({});
+                errors.str({});
+            }, static_cast<std::size_t>(commands));
+    }
+
+    // Appends the matrices an eval line needs, enough for any of the evaluated functions
+    std::string withMatrices(const std::string& script)
+    {
+        auto matrices = std::string();
+        for (int i = 0; i < MAX_MAT_SIZE * MAX_MAT_SIZE * 64; ++i)
+            matrices += ' ' + std::to_string(i % 9 - 4);
+
+        auto result = std::string();
+        auto lines = std::istringstream(script);
+        for (std::string line; std::getline(lines, line);)
+            result += line.starts_with("eval ") ? line + matrices + '\n' : line + '\n';
+        return result;
+    }
+
+    // Evaluations whose inputs are sparse enough to be parsed into CSR form, so eval
+    // runs the CSR merge, transpose and scale on command input
+    std::string sparseScript(std::mt19937& random)
+    {
+        const auto cells = SPARSE_MIN_SIZE * SPARSE_MIN_SIZE;
+        const auto nonZeros = static_cast<int>(SPARSE_LOAD_DENSITY / 2 * cells);
+        const auto matrix = [&]
+            {
+                auto values = std::vector<int>(static_cast<std::size_t>(cells));
+                for (int i = 0; i < nonZeros; ++i)
+                    values[std::uniform_int_distribution<std::size_t>(0, values.size() - 1)(random)]
+                        = std::uniform_int_distribution<int>(1, 9)(random);
+                auto text = std::string();
+                for (const int value : values)
+                    text += ' ' + std::to_string(value);
+                return text;
+            };
+
+        // #2 scales, #3 adds a matrix to a transpose, #4 subtracts a transpose from a scaled matrix
+        auto script = std::string("scal 2\nadd 0 1\nsub 2 1\n");
+        for (int i = 0; i < SPARSE_EVALS; ++i)
+            script += "eval " + std::to_string(2 + i % 3) + ' ' + std::to_string(SPARSE_MIN_SIZE)
+                + matrix() + (i % 3 == 0 ? "" : matrix()) + '\n';
+        return script;
+    }
+}
+
+
+void addScriptBenchmarks(BenchRunner& runner)
+{
+    auto random = std::mt19937(7);
+
+    auto define = std::ostringstream();
+    appendDefinitions(define, random);
+    measureScript(runner, "define", define.str(), FUNCTIONS);
+
+    auto eval = std::ostringstream();
+    appendDefinitions(eval, random);
+    appendEvals(eval, random, FUNCTIONS);
+    measureScript(runner, "define_eval", withMatrices(eval.str()), FUNCTIONS + EVALS);
+    measureScript(runner, "eval_sparse", sparseScript(random), 3 + SPARSE_EVALS);
+}
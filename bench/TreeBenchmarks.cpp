@@ -0,0 +1,113 @@
+#include "Benchmark.h"
+#include "Add.h"
+#include "Sub.h"
+#include "Comp.h"
+#include "Scalar.h"
+#include "Identity.h"
+#include "JitCompiler.h"
+#include "DagPrinter.h"
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <sstream>
+
+namespace
+{
+    constexpr int SIZE = MAX_MAT_SIZE;
+    constexpr int CHAIN_DEPTHS[] = { 1, 4, 16, 64 };
+    constexpr int BALANCED_DEPTHS[] = { 1, 4, 8, 12 };
+    // Far deeper than the call stack allows one frame per level for
+    constexpr int DAG_CHAIN_DEPTH = 100'000;
+
+    using OperationPtr = std::shared_ptr<Operation>;
+
+    OperationPtr combine(const std::string& kind, const OperationPtr& first, const OperationPtr& second)
+    {
+        if (kind == "add")
+            return std::make_shared<Add>(first, second);
+        if (kind == "sub")
+            return std::make_shared<Sub>(first, second);
+        return std::make_shared<Comp>(first, second);
+    }
+
+    // Deep tree: every level adds one leaf, so the tree has depth nodes of the kind
+    OperationPtr chain(const std::string& kind, int depth, const OperationPtr& leaf)
+    {
+        auto root = leaf;
+        for (int i = 0; i < depth; ++i)
+            root = combine(kind, root, leaf);
+        return root;
+    }
+
+    // Wide tree: every level uses the previous one twice, so evaluation visits 2^depth leaves
+    OperationPtr balanced(const std::string& kind, int depth, const OperationPtr& leaf)
+    {
+        auto root = leaf;
+        for (int i = 0; i < depth; ++i)
+            root = combine(kind, root, root);
+        return root;
+    }
+
+    std::vector<Operation::T> inputsFor(const Operation& operation)
+    {
+        auto input = Operation::T(SIZE);
+        for (int i = 0; i < SIZE; ++i)
+            for (int j = 0; j < SIZE; ++j)
+                input(i, j) = (i * SIZE + j) % 7 - 3;
+        return std::vector<Operation::T>(static_cast<std::size_t>(operation.inputCount()), input);
+    }
+
+    void measureTree(BenchRunner& runner, const std::string& name, int param, const OperationPtr& root)
+    {
+        const auto inputs = inputsFor(*root);
+        runner.measure("tree", name, param, [&] { doNotOptimize(root->evaluate(inputs)); });
+    }
+
+    // Skipped when the kernel cannot be built, e.g. without a system compiler
+    void measureCompiled(BenchRunner& runner, JitCompiler& jit, const std::string& name, int param, const OperationPtr& root)
+    {
+        if (!jit.compile(root, SIZE))
+            return;
+        const auto inputs = inputsFor(*root);
+        runner.measure("tree", name, param, [&] { doNotOptimize(jit.evaluate(*root, inputs)); });
+    }
+}
+
+
+void addTreeBenchmarks(BenchRunner& runner)
+{
+    // scal 1 keeps every value in range however many times it is applied, id leaves test the plain traversal
+    const auto scale = OperationPtr(std::make_shared<Scalar>(1));
+    const auto identity = OperationPtr(std::make_shared<Identity>());
+
+    for (const int depth : CHAIN_DEPTHS)
+        measureTree(runner, "scal_chain", depth, chain("comp", depth, scale));
+
+    for (const std::string kind : { "add", "sub", "comp" })
+    {
+        const auto& leaf = kind == "comp" ? scale : identity;
+        for (const int depth : CHAIN_DEPTHS)
+            measureTree(runner, kind + "_chain", depth, chain(kind, depth, leaf));
+        // A balanced sum doubles the inputs per level and leaves the allowed range past depth 8
+        for (const int depth : BALANCED_DEPTHS)
+            if (kind != "add" || depth <= 8)
+                measureTree(runner, kind + "_balanced", depth, balanced(kind, depth, leaf));
+    }
+
+    // 'view dag' of a chain the size of a long script, which must not recurse per level
+    const auto deep = chain("comp", DAG_CHAIN_DEPTH, identity);
+    auto output = std::ostringstream();
+    runner.measure("tree", "dag_print_chain", DAG_CHAIN_DEPTH, [&]
+        {
+            output.str({});
+            DagPrinter::print(output, *deep);
+        });
+
+    // The same trees as native kernels, compiled once and then cached on disk
+    auto jit = JitCompiler();
+    for (const int depth : CHAIN_DEPTHS)
+        measureCompiled(runner, jit, "jit_scal_chain", depth, chain("comp", depth, scale));
+    for (const int depth : BALANCED_DEPTHS)
+        measureCompiled(runner, jit, "jit_comp_balanced", depth, balanced("comp", depth, scale));
+}
@@ -0,0 +1,91 @@
+#include "Benchmark.h"
+#include "Tokenizer.h"
+
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+namespace
+{
+    constexpr auto USAGE = "Usage: oop2_ex03_bench [--format json|csv] [--output path] [--baseline results.csv]"
+        " [--threshold percent] [--min-time ms] [--filter group/name]";
+}
+
+
+// Runs the matrix kernel, tree evaluation and script throughput benchmarks
+// With --baseline, compares against results written earlier with --format csv
+// and exits with 1 when a case got slower than the threshold
+int main(int argc, char* argv[])
+{
+    auto format = std::string("json");
+    auto outputPath = std::string();
+    auto baselinePath = std::string();
+    auto filter = std::string();
+    int threshold = 10;
+    int minTime = 500;
+
+    for (int i = 1; i + 1 < argc || (i < argc && std::string_view(argv[i]) == "--help"); i += 2)
+    {
+        const auto arg = std::string_view(argv[i]);
+        const auto value = std::string(i + 1 < argc ? argv[i + 1] : "");
+        const auto number = Tokenizer(value).nextInt();
+        if (arg == "--format" && (value == "json" || value == "csv"))
+            format = value;
+        else if (arg == "--output")
+            outputPath = value;
+        else if (arg == "--baseline")
+            baselinePath = value;
+        else if (arg == "--filter")
+            filter = value;
+        else if (arg == "--threshold" && number && *number >= 0)
+            threshold = *number;
+        else if (arg == "--min-time" && number && *number > 0)
+            minTime = *number;
+        else
+        {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        std::cerr << USAGE << std::endl;
+        return 2;
+    }
+
+    auto runner = BenchRunner(std::chrono::milliseconds(minTime), filter);
+    addMatrixBenchmarks(runner);
+    addTreeBenchmarks(runner);
+    addScriptBenchmarks(runner);
+
+    auto file = std::ofstream();
+    if (!outputPath.empty())
+    {
+        file.open(outputPath);
+        if (!file)
+        {
+            std::cerr << "Failed to open file: " << outputPath << std::endl;
+            return 2;
+        }
+    }
+    auto& output = outputPath.empty() ? std::cout : file;
+    if (format == "csv")
+        writeCsv(output, runner.results());
+    else
+        writeJson(output, runner.results());
+
+    if (baselinePath.empty())
+        return 0;
+
+    auto baselineFile = std::ifstream(baselinePath);
+    if (!baselineFile)
+    {
+        std::cerr << "Failed to open file: " << baselinePath << std::endl;
+        return 2;
+    }
+    const auto regressions = compareWithBaseline(std::cerr, runner.results(), readCsv(baselineFile), threshold);
+    std::cerr << regressions << " regressions above " << threshold << "%\n";
+    return regressions == 0 ? 0 : 1;
+}
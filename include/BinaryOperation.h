@@ -3,20 +3,34 @@
 #include "Operation.h"
 
 #include <memory>
+#include <array>
+#include <string>
+#include <cstddef>
+
+// Longest printed form cached by a binary operation
+// Longer forms are printed on demand, e.g. through DagPrinter
+constexpr std::size_t RENDER_CACHE_LIMIT = 4096;
 
 
 class BinaryOperation : public Operation
 {
 public:
-    BinaryOperation(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2);
-	int inputCount() const override { return m_first->inputCount() + m_second->inputCount(); }
+    BinaryOperation(OperationKind kind, const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2);
+    void print(std::ostream& ostr, bool first_print =false) const override;
+    void printNode(std::ostream& ostr, bool first_print, const ChildPrinter& printChild) const override;
+    bool isRenderingCached() const override { return m_isRenderingCached; }
+    std::span<const std::shared_ptr<Operation>> children() const override { return m_children; }
 protected:
-    const std::shared_ptr<Operation>& first() const { return m_first; }
-    const std::shared_ptr<Operation>& second() const { return m_second; }
+    const std::shared_ptr<Operation>& first() const { return m_children[0]; }
+    const std::shared_ptr<Operation>& second() const { return m_children[1]; }
     virtual void printSymbol(std::ostream& ostr) const = 0;
-    void print(std::ostream& ostr, bool first_print =false) const override;
+
+    // Renders the operation once, called by the derived constructors
+    // since printSymbol() cannot be dispatched from the base constructor
+    void cacheRendering();
 
 private:
-    const std::shared_ptr<Operation> m_first;
-    const std::shared_ptr<Operation> m_second;
+    const std::array<std::shared_ptr<Operation>, 2> m_children;
+    std::string m_rendering; // without the outer parentheses
+    bool m_isRenderingCached = false;
 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "FunctionCalculator.h"
+#include "LatencyHistogram.h"
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <iosfwd>
+
+
+// Serves one shared function registry to many clients
+// A request is a command line, a response is a header line "ok <length>" or
+// "err <length>" followed by <length> bytes of command output
+// Commands that only read the registry run in parallel, each on the snapshot
+// that was current when it started. Commands that change the registry are
+// serialized by the writer lock and publish a new snapshot when they are done,
+// so readers never wait for writers (RCU over the O(1) registry snapshots)
+// Besides the calculator commands the server answers "latency" with the
+// p50/p99 counters, and "shutdown" stops it
+class CalculatorServer
+{
+public:
+    CalculatorServer(int maxFunctions, int maxMatrixSize);
+
+    // A single client over a pair of streams, until the input ends or the client exits
+    void serveStream(std::istream& istr, std::ostream& ostr);
+    // A thread per client on a Unix domain socket, until a client sends "shutdown"
+    // Clients still connected then are disconnected once their pending lines are answered
+    void serveSocket(const std::string& path);
+
+    std::string latencyReport() const;
+
+private:
+    struct Session;
+
+    struct Response
+    {
+        bool ok;
+        std::string output;
+        bool close = false;
+    };
+
+    std::atomic<std::shared_ptr<const FunctionCalculator::Snapshot>> m_state;
+    const int m_maxMatrixSize;
+    // Runs the background jobs of all sessions
+    const std::shared_ptr<ThreadPool> m_pool = JobManager::makePool();
+    std::mutex m_writer;
+    LatencyHistogram m_readLatency;
+    LatencyHistogram m_writeLatency;
+
+    std::atomic<bool> m_stopping = false;
+    std::atomic<int> m_listener = -1;
+    std::mutex m_clientsMutex;
+    std::condition_variable m_clientsDone;
+    std::set<int> m_clients; // sockets of the connected clients
+
+    Response handle(Session& session, std::string_view line);
+    Response execute(Session& session, std::string_view line);
+    void stop();
+    void serveClient(int socket);
+
+    static std::string frame(const Response& response);
+};
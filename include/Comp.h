@@ -9,9 +9,8 @@
 class Comp : public BinaryOperation
 {
 public:
-    using BinaryOperation::BinaryOperation;
-    int inputCount() const override;
-    T compute(const std::vector<T>& input) const override;
+    Comp(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2);
+    Result tryCompute(std::span<const T> input) const override;
     void printSymbol(std::ostream& ostr) const override;
    
 };
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "MatrixError.h"
+#include "MatrixView.h"
+
+#include <vector>
+#include <expected>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+
+
+// Integral elements are combined in a wider type, so an overflowing
+// intermediate is caught by the range check instead of wrapping around
+template <typename T>
+using WideElement = std::conditional_t<std::is_integral_v<T>, long long, T>;
+
+// Compressed sparse row storage for large, mostly zero square matrices
+// Only the non-zero elements are stored, ordered by row and then by column
+template <typename T>
+class CsrMatrix
+{
+public:
+    using Wide = WideElement<T>;
+    using Result = std::expected<CsrMatrix, MatrixError>;
+
+    // All zero matrix
+    explicit CsrMatrix(int size);
+    static CsrMatrix fromView(const MatrixView<T>& view);
+    static CsrMatrix fromDiagonal(const std::vector<T>& values);
+    static std::size_t countNonZeros(const MatrixView<T>& view);
+
+    int size() const { return m_size; }
+    std::size_t nonZeros() const { return m_values.size(); }
+    double density() const;
+
+    // Returns the stored element, or nullptr when (i, j) is zero
+    const T* find(int i, int j) const;
+
+    // Counting sort by column, O(n + nnz)
+    CsrMatrix transposed() const;
+
+    // Merges the rows of both matrices, applying func(a, b) where either side is non-zero
+    template <typename Func, typename Check>
+    Result merge(const CsrMatrix& rhs, char op, Func func, Check inRange) const;
+    template <typename Check>
+    Result scaled(const T& scalar, Check inRange) const;
+
+    // Writes all n x n elements in row-major order
+    void copyTo(T* out) const;
+
+private:
+    int m_size;
+    std::vector<std::size_t> m_rowStart; // m_size + 1 offsets into m_columns / m_values
+    std::vector<int> m_columns;
+    std::vector<T> m_values;
+
+    // Empty matrix whose rows are appended with push() and endRow()
+    static CsrMatrix builder(int size);
+
+    std::size_t rowBegin(int i) const { return m_rowStart[static_cast<std::size_t>(i)]; }
+    std::size_t rowEnd(int i) const { return m_rowStart[static_cast<std::size_t>(i) + 1]; }
+    void push(int col, const T& value);
+    void endRow() { m_rowStart.push_back(m_values.size()); }
+};
+
+template <typename T>
+CsrMatrix<T>::CsrMatrix(int size)
+    : m_size(size), m_rowStart(static_cast<std::size_t>(size) + 1, 0)
+{
+}
+
+template <typename T>
+CsrMatrix<T> CsrMatrix<T>::builder(int size)
+{
+    auto result = CsrMatrix(0);
+    result.m_size = size;
+    result.m_rowStart.reserve(static_cast<std::size_t>(size) + 1);
+    return result;
+}
+
+template <typename T>
+void CsrMatrix<T>::push(int col, const T& value)
+{
+    m_columns.push_back(col);
+    m_values.push_back(value);
+}
+
+template <typename T>
+std::size_t CsrMatrix<T>::countNonZeros(const MatrixView<T>& view)
+{
+    std::size_t count = 0;
+    for (int i = 0; i < view.size(); ++i)
+        for (int j = 0; j < view.size(); ++j)
+            if (view(i, j) != T())
+                ++count;
+    return count;
+}
+
+template <typename T>
+CsrMatrix<T> CsrMatrix<T>::fromView(const MatrixView<T>& view)
+{
+    auto result = builder(view.size());
+    for (int i = 0; i < view.size(); ++i)
+    {
+        for (int j = 0; j < view.size(); ++j)
+        {
+            if (view(i, j) != T())
+                result.push(j, view(i, j));
+        }
+        result.endRow();
+    }
+    return result;
+}
+
+template <typename T>
+CsrMatrix<T> CsrMatrix<T>::fromDiagonal(const std::vector<T>& values)
+{
+    auto result = builder(static_cast<int>(values.size()));
+    for (int i = 0; i < result.m_size; ++i)
+    {
+        if (values[static_cast<std::size_t>(i)] != T())
+            result.push(i, values[static_cast<std::size_t>(i)]);
+        result.endRow();
+    }
+    return result;
+}
+
+template <typename T>
+double CsrMatrix<T>::density() const
+{
+    const double cells = static_cast<double>(m_size) * static_cast<double>(m_size);
+    return cells > 0 ? static_cast<double>(nonZeros()) / cells : 0.0;
+}
+
+template <typename T>
+const T* CsrMatrix<T>::find(int i, int j) const
+{
+    const auto begin = m_columns.begin() + static_cast<std::ptrdiff_t>(rowBegin(i));
+    const auto end = m_columns.begin() + static_cast<std::ptrdiff_t>(rowEnd(i));
+    const auto it = std::lower_bound(begin, end, j);
+    if (it == end || *it != j)
+        return nullptr;
+    return &m_values[static_cast<std::size_t>(it - m_columns.begin())];
+}
+
+template <typename T>
+CsrMatrix<T> CsrMatrix<T>::transposed() const
+{
+    auto result = CsrMatrix(m_size);
+    const auto n = static_cast<std::size_t>(m_size);
+
+    // Count the entries of every column, then turn the counts into row offsets
+    result.m_rowStart.assign(n + 1, 0);
+    for (const int col : m_columns)
+        ++result.m_rowStart[static_cast<std::size_t>(col) + 1];
+    for (std::size_t k = 0; k < n; ++k)
+        result.m_rowStart[k + 1] += result.m_rowStart[k];
+
+    result.m_columns.resize(nonZeros());
+    result.m_values.resize(nonZeros());
+    auto next = std::vector<std::size_t>(result.m_rowStart.begin(), result.m_rowStart.end() - 1);
+    for (int i = 0; i < m_size; ++i)
+    {
+        for (auto k = rowBegin(i); k < rowEnd(i); ++k)
+        {
+            const auto dest = next[static_cast<std::size_t>(m_columns[k])]++;
+            result.m_columns[dest] = i;
+            result.m_values[dest] = m_values[k];
+        }
+    }
+    return result;
+}
+
+template <typename T>
+template <typename Func, typename Check>
+typename CsrMatrix<T>::Result CsrMatrix<T>::merge(const CsrMatrix& rhs, char op, Func func, Check inRange) const
+{
+    auto result = builder(m_size);
+    result.m_columns.reserve(std::max(nonZeros(), rhs.nonZeros()));
+    result.m_values.reserve(std::max(nonZeros(), rhs.nonZeros()));
+
+    for (int i = 0; i < m_size; ++i)
+    {
+        auto a = rowBegin(i);
+        auto b = rhs.rowBegin(i);
+        while (a < rowEnd(i) || b < rhs.rowEnd(i))
+        {
+            const int colA = a < rowEnd(i) ? m_columns[a] : m_size;
+            const int colB = b < rhs.rowEnd(i) ? rhs.m_columns[b] : m_size;
+            const int col = std::min(colA, colB);
+            const Wide lhsValue = colA == col ? Wide(m_values[a++]) : Wide();
+            const Wide rhsValue = colB == col ? Wide(rhs.m_values[b++]) : Wide();
+
+            const Wide value = func(lhsValue, rhsValue);
+            if (!inRange(value))
+                return std::unexpected(MatrixError{ MatrixErrorCode::ComputedOutOfRange, i, col,
+                    static_cast<long long>(value), op });
+            if (value != Wide())
+                result.push(col, static_cast<T>(value));
+        }
+        result.endRow();
+    }
+    return result;
+}
+
+template <typename T>
+template <typename Check>
+typename CsrMatrix<T>::Result CsrMatrix<T>::scaled(const T& scalar, Check inRange) const
+{
+    if (scalar == T())
+        return CsrMatrix(m_size);
+
+    auto result = *this;
+    for (int i = 0; i < m_size; ++i)
+    {
+        for (auto k = rowBegin(i); k < rowEnd(i); ++k)
+        {
+            const Wide value = Wide(m_values[k]) * Wide(scalar);
+            if (!inRange(value))
+                return std::unexpected(MatrixError{ MatrixErrorCode::ComputedOutOfRange, i, m_columns[k],
+                    static_cast<long long>(value), '*' });
+            result.m_values[k] = static_cast<T>(value);
+        }
+    }
+    return result;
+}
+
+template <typename T>
+void CsrMatrix<T>::copyTo(T* out) const
+{
+    const auto n = static_cast<std::size_t>(m_size);
+    std::fill(out, out + n * n, T());
+    for (int i = 0; i < m_size; ++i)
+        for (auto k = rowBegin(i); k < rowEnd(i); ++k)
+            out[static_cast<std::size_t>(i) * n + static_cast<std::size_t>(m_columns[k])] = m_values[k];
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <iosfwd>
+
+class Operation;
+
+
+// Prints an operation as a DAG: every compound sub-operation that is
+// used more than once is written a single time as a let-binding, e.g.
+// "let f1 = id + scal 3; f1 + f1"
+// The output is linear in the number of distinct operations, while the
+// plain tree form doubles with every level that reuses a sub-operation
+// Operations nested deeper than MAX_INLINE_DEPTH are bound as well, so a
+// long chain prints without recursing once per level
+class DagPrinter
+{
+public:
+    static void print(std::ostream& ostr, const Operation& root);
+
+private:
+    static constexpr int MAX_INLINE_DEPTH = 64;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+
+
+// Return type of a coroutine that starts at once and frees its own frame
+// when it ends. Nobody awaits it, so the coroutine reports its outcome
+// through state it shares with its caller and must not let exceptions escape
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+
+
+// Cancellation flag of the evaluation running on the current thread
+// Operation::evaluate() checks it before every node, so a cancelled job
+// stops at the next node boundary
+class EvalContext
+{
+public:
+    // Installs the flag for the lifetime of the object
+    explicit EvalContext(const std::atomic<bool>& cancelled)
+        : m_previous(t_cancelled)
+    {
+        t_cancelled = &cancelled;
+    }
+
+    ~EvalContext()
+    {
+        t_cancelled = m_previous;
+    }
+
+    EvalContext(const EvalContext&) = delete;
+    EvalContext& operator=(const EvalContext&) = delete;
+
+    static bool isCancelled()
+    {
+        return t_cancelled && t_cancelled->load(std::memory_order_relaxed);
+    }
+
+private:
+    const std::atomic<bool>* m_previous;
+
+    inline static thread_local const std::atomic<bool>* t_cancelled = nullptr;
+};
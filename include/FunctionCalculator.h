@@ -1,11 +1,21 @@
 #pragma once
 
+#include "MatrixError.h"
+#include "Tokenizer.h"
+#include "FunctionRegistry.h"
+#include "JobManager.h"
+#include "JitCompiler.h"
+
 #include <vector>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <iosfwd>
 #include <optional>
 #include <iostream>
+#include <expected>
+#include <deque>
+#include <cstddef>
 
 class Operation;
 
@@ -16,51 +26,109 @@ public:
     void run();
     void executeFromFile(const std::string& filePath);
 
+    // Matrix range errors are returned rather than thrown, so batch
+    // workloads with many rejected inputs avoid unwinding per line
+    using CommandResult = std::expected<void, MatrixError>;
+
+    // Runs one command line, other errors are thrown as std::invalid_argument
+    CommandResult executeSingleCommand(std::string_view line);
+
+    static constexpr int MAX_FUNCTIONS_LIMIT = 10'000'000;
+    static constexpr int MAX_MAT_SIZE_LIMIT = 4096;
+
+    // A non-interactive calculator prints no prompts and never reads from
+    // the user, a failing line of a nested 'read' fails the whole 'read'
+    bool isInteractive() const { return m_interactive; }
+    void setInteractive(bool interactive) { m_interactive = interactive; }
+    void setMaxFunctions(int maxFunctions);
+    // Largest n accepted for n׳n input matrices, MAX_MAT_SIZE unless raised, e.g. so
+    // scripts can evaluate inputs large enough for the sparse backend
+    void setMaxMatrixSize(int maxMatrixSize);
+    // Runs the background jobs on a pool shared with other calculators
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { m_jobs.setPool(std::move(pool)); }
+    // Without undo no history of the function list is kept, e.g. for server sessions
+    // whose list is shared and replaced before every command
+    void setUndoEnabled(bool enabled);
+    // False once 'exit' was executed
+    bool isRunning() const { return m_running; }
+
+    // Whether the command changes the function list, nothing for an unknown command
+    static std::optional<bool> mutatesRegistry(std::string_view command);
+
+    // Copies of the registry are O(1) snapshots
+    using OperationList = FunctionRegistry;
+
+    struct Snapshot
+    {
+        OperationList operations;
+        int maxFunctions;
+    };
+
+    Snapshot snapshot() const;
+    void restore(const Snapshot& state);
+
 private:
-    void eval();
-    void del();
+
+    CommandResult eval(Tokenizer& args);
+    CommandResult async(Tokenizer& args);
+    CommandResult wait(Tokenizer& args);
+    void jobs() const;
+    void cancel(Tokenizer& args);
+    void stats(Tokenizer& args);
+    CommandResult trace(Tokenizer& args);
+    void jit(Tokenizer& args);
+    void del(Tokenizer& args);
+    void name(Tokenizer& args);
+    void list(Tokenizer& args);
+    void view(Tokenizer& args);
+    void describe(Tokenizer& args);
+    void save(Tokenizer& args) const;
+    void load(Tokenizer& args);
     void help();
+    void undo();
     void exit();
     void askMaxFunctions();
     bool askUserToContinue();
-    void executeSingleCommand(const std::string& line);
     void ensureSpace() const;
 
     template <typename FuncType>
-    void binaryFunc()
+    void binaryFunc(Tokenizer& args)
     {
         ensureSpace();
-        auto f0 = readOperationIndex();
-        auto f1 = readOperationIndex();
+        auto f0 = readOperation(args);
+        auto f1 = readOperation(args);
 
         if (!f0 || !f1)
             throw std::invalid_argument("Invalid arguments: operation does not exist in the operation list.");
-        m_operations.push_back(std::make_shared<FuncType>(m_operations[*f0], m_operations[*f1]));
+        auto operation = std::make_shared<FuncType>(f0, f1);
+        if (operation->inputCount() == MAX_INPUT_COUNT)
+            throw std::invalid_argument("Invalid arguments: the operation would take too many input matrices.");
+        m_operations.insert(std::move(operation));
     }
 
     template <typename FuncType>
-    void unaryFunc()
+    void unaryFunc(Tokenizer& args)
     {
         ensureSpace();
-        auto idx = readOperationIndex();
-        if (!idx)
+        auto operation = readOperation(args);
+        if (!operation)
             throw std::invalid_argument("Invalid arguments: operation does not exist in the operation list.");
-        m_operations.push_back(std::make_shared<FuncType>(m_operations[*idx]));
+        m_operations.insert(std::make_shared<FuncType>(operation));
     }
 
     template <typename FuncType>
-    void unaryWithIntFunc()
+    void unaryWithIntFunc(Tokenizer& args)
     {
         ensureSpace();
-        int value = 0;
-        m_istr >> value;
+        const auto value = args.nextInt();
 
-        if (!m_istr)
+        if (!value)
             throw std::invalid_argument("Invalid scalar value.");
-        m_operations.push_back(std::make_shared<FuncType>(value));
+        m_operations.insert(std::make_shared<FuncType>(*value));
     }
 
-    void printOperations() const;
+    // Lists the live functions [page * LIST_PAGE_SIZE, (page + 1) * LIST_PAGE_SIZE), free slots are skipped
+    void printOperations(std::size_t page = 0) const;
 
     enum class Action
     {
@@ -78,32 +146,68 @@ private:
         Help,
         Exit,
         Resize,
+        Undo,
+        Name,
+        List,
+        View,
+        Describe,
+        Save,
+        Load,
+        Async,
+        Jobs,
+        Wait,
+        Cancel,
+        Stats,
+        Trace,
+        Jit,
     };
 
+    // Number of arguments a command takes, ANY_ARGS for an unbounded maximum
+    static constexpr int ANY_ARGS = -1;
+
     struct ActionDetails
     {
-        std::string command;
-        std::string description;
+        std::string_view command;
+        std::string_view description;
         Action action;
+        int minArgs;
+        int maxArgs;
+        bool mutates; // changes the function list or its capacity
     };
 
-    using ActionMap = std::vector<ActionDetails>;
-    using OperationList = std::vector<std::shared_ptr<Operation>>;
+    static constexpr std::size_t MAX_UNDO_STEPS = 100;
+    static constexpr std::size_t LIST_PAGE_SIZE = 20;
 
-    ActionMap m_actions;
     OperationList m_operations;
+    std::deque<Snapshot> m_history;
+    int m_fileDepth = 0;
     bool m_running = true;
+    bool m_dagView = false;
+    bool m_undoEnabled = true;
     int m_maxFunctions = 100;
+    int m_maxMatrixSize = MAX_MAT_SIZE;
     std::istream& m_istr;
     std::ostream& m_ostr;
-    ///
     bool m_interactive = true;
-
-    std::optional<int> readOperationIndex() const;
-    Action readAction() const;
-
-    void runAction(Action action);
-    ActionMap createActions() const;
+    JobManager m_jobs;
+    JitCompiler m_jit;
+
+    // Accepts a function ID or name, reports a missing function and returns nothing
+    std::optional<FunctionId> readOperationId(Tokenizer& args) const;
+    std::shared_ptr<Operation> readOperation(Tokenizer& args) const;
+    int readMatrixSize(Tokenizer& args) const;
+    // Reads the matrix size and the matrices an operation takes
+    std::expected<std::vector<Operation::T>, MatrixError> readInputs(Tokenizer& args, const Operation& operation);
+    void printResult(const Operation& operation, const std::vector<Operation::T>& inputs,
+        const Operation::T& result) const;
+    // Tree form, or DAG form in 'view dag' mode and when the tree is too large
+    void printOperation(const Operation& operation) const;
+    std::shared_ptr<JobManager::Job> readJob(Tokenizer& args) const;
+
+    CommandResult runAction(Action action, Tokenizer& args);
+    // Command table, defined in the source file where its perfect hash is built
+    static constexpr auto actionTable();
+    static const ActionDetails* findAction(std::string_view command);
     OperationList createOperations() const;
-    void resizeOperations();
+    void resizeOperations(Tokenizer& args);
 };
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "PersistentVector.h"
+#include "PersistentMap.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+#include <cstddef>
+
+class Operation;
+
+
+// Stable handle of a registered function
+// The slot index may be reused after a delete, the generation tells the
+// new function apart from the deleted one, so an old ID never aliases it
+struct FunctionId
+{
+    std::uint32_t index = 0;
+    std::uint32_t generation = 0;
+
+    bool operator==(const FunctionId&) const = default;
+};
+
+// Printed as "index", or "index.generation" once the slot was reused
+std::ostream& operator<<(std::ostream& ostr, const FunctionId& id);
+
+
+// Slab of operations with a free list: insert, delete and lookup by ID
+// or by name are O(1) (up to the shallow tree of the PersistentVector),
+// and copying a registry is an O(1) snapshot
+// The name index is a PersistentMap, so naming or deleting a named function
+// copies only a path of it and snapshots stay O(1) however many names there are
+class FunctionRegistry
+{
+public:
+    // The full state of one slot, used to save and rebuild a registry
+    struct SlotRecord
+    {
+        std::shared_ptr<Operation> operation; // null for a free slot
+        std::uint32_t generation = 0;
+        std::string name;
+    };
+
+    FunctionRegistry() = default;
+
+    // Rebuilds a registry slot by slot, nothing when two functions share a
+    // name or a name is invalid. Free slots are reused lowest index first
+    static std::optional<FunctionRegistry> fromSlots(const std::vector<SlotRecord>& slots);
+    SlotRecord slotRecord(std::size_t index) const;
+
+    std::size_t size() const { return m_count; }
+    // One past the highest slot index ever used
+    std::size_t slotCount() const { return m_slots.size(); }
+
+    FunctionId insert(std::shared_ptr<Operation> operation);
+    bool erase(FunctionId id);
+    // Deletes the functions with the highest slot indices until newSize remain
+    void shrinkTo(std::size_t newSize);
+
+    std::shared_ptr<Operation> find(FunctionId id) const;
+    // Resolves "index", "index.generation" or a function name
+    std::optional<FunctionId> resolve(std::string_view token) const;
+
+    // Names must start with a letter so they never look like an ID
+    bool setName(FunctionId id, const std::string& name);
+    const std::string* nameOf(FunctionId id) const;
+
+    // Calls func(id, operation) for the live functions in slots [first, last)
+    template <typename Func>
+    void forEachInSlots(std::size_t first, std::size_t last, Func func) const;
+    // Calls func(id, operation) for up to count live functions in slot order,
+    // starting with the one that has skip live functions before it
+    template <typename Func>
+    void forEachLive(std::size_t skip, std::size_t count, Func func) const;
+
+    bool sharesStateWith(const FunctionRegistry& other) const
+    {
+        return m_slots.sharesStateWith(other.m_slots) && m_names.sharesStateWith(other.m_names);
+    }
+
+private:
+    static constexpr std::uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Slot
+    {
+        std::shared_ptr<Operation> operation; // null while the slot is free
+        std::shared_ptr<const std::string> name;
+        std::uint32_t generation = 0;
+        std::uint32_t nextFree = NO_SLOT;
+    };
+
+    PersistentVector<Slot> m_slots;
+    PersistentMap<std::string, FunctionId> m_names;
+    std::uint32_t m_freeHead = NO_SLOT;
+    std::size_t m_count = 0;
+
+    const Slot* slotOf(FunctionId id) const;
+};
+
+template <typename Func>
+void FunctionRegistry::forEachInSlots(std::size_t first, std::size_t last, Func func) const
+{
+    for (auto i = first; i < last && i < m_slots.size(); ++i)
+    {
+        const auto& slot = m_slots[i];
+        if (slot.operation)
+            func(FunctionId{ static_cast<std::uint32_t>(i), slot.generation }, slot.operation);
+    }
+}
+
+template <typename Func>
+void FunctionRegistry::forEachLive(std::size_t skip, std::size_t count, Func func) const
+{
+    for (std::size_t i = 0; i < m_slots.size() && count > 0; ++i)
+    {
+        const auto& slot = m_slots[i];
+        if (!slot.operation)
+            continue;
+        if (skip > 0)
+        {
+            --skip;
+            continue;
+        }
+        func(FunctionId{ static_cast<std::uint32_t>(i), slot.generation }, slot.operation);
+        --count;
+    }
+}
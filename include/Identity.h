@@ -9,8 +9,8 @@
 class Identity : public UnaryOperation
 {
 public:
-    using UnaryOperation::UnaryOperation;
-	T compute(const std::vector<T>& input) const override;
+    Identity();
+	Result tryCompute(std::span<const T> input) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 };
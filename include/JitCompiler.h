@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <string>
+#include <memory>
+#include <map>
+#include <utility>
+#include <expected>
+#include <optional>
+#include <span>
+#include <filesystem>
+#include <cstdint>
+
+
+// Evaluation of one operation tree for one matrix size, specialized into
+// native code by JitCompiler and loaded from a shared object
+class NativeKernel
+{
+public:
+    // Loads a shared object written by JitCompiler, nothing when it cannot be
+    // loaded or was built for another tree, size or number of inputs
+    static std::shared_ptr<NativeKernel> load(const std::filesystem::path& path, std::uint64_t hash, int size,
+        int inputCount);
+    ~NativeKernel();
+    NativeKernel(const NativeKernel&) = delete;
+    NativeKernel& operator=(const NativeKernel&) = delete;
+
+    int size() const { return m_size; }
+
+    // The result, nothing when an intermediate element is out of range or the
+    // inputs are not inputCount matrices of the kernel's size
+    // Kernels are pure functions, so any thread may run one
+    std::optional<Operation::T> run(std::span<const Operation::T> inputs) const;
+
+private:
+    // Reads the input matrices as row-major arrays, returns non-zero on a range error
+    using Function = int (*)(const int* const* inputs, int* output);
+
+    NativeKernel(void* handle, Function function, int size, int inputCount);
+
+    void* m_handle;
+    Function m_function;
+    int m_size;
+    int m_inputCount;
+};
+
+
+// Compiles operation trees to native code with the system C++ compiler
+// Every operation is element-wise up to transposes, so one output element
+// is a single expression over one element of each input: the generated
+// kernel evaluates it for all elements in a loop the compiler fully unrolls
+// and vectorizes, without intermediate matrices, and collects the range
+// checks of all nodes into one flag that is tested once at the end
+// Sources and shared objects are cached on disk by structural hash and
+// size, a cached object is reused only if its source matches the tree
+// Because cached objects are loaded as code, the cache directory must be
+// owned by the current user and writable by nobody else
+// POSIX only: elsewhere compile() reports that and evaluate() interprets
+class JitCompiler
+{
+public:
+    struct Compiled
+    {
+        std::filesystem::path library;
+        bool cached; // loaded from the disk cache instead of compiled
+        double seconds;
+    };
+
+    // The directory is FC_JIT_CACHE_DIR when set, otherwise oop2_ex03_jit in
+    // XDG_CACHE_HOME or ~/.cache, or a per-user directory in the temporary directory
+    JitCompiler();
+    explicit JitCompiler(std::filesystem::path cacheDirectory);
+
+    // Builds and loads the kernel of operation on size x size matrices and routes
+    // later evaluate() calls of the pair to it, or describes why it could not
+    // The compiler is CXX when set, c++ otherwise
+    std::expected<Compiled, std::string> compile(const std::shared_ptr<Operation>& operation, int size);
+
+    // Runs the compiled kernel of the operation and input size if there is one, the
+    // interpreter otherwise. Inputs that make any node leave the allowed range are
+    // evaluated again by the interpreter, so errors are reported exactly as before
+    // Compiled evaluations are neither cancellable nor counted by the profiler
+    Operation::Result evaluate(const Operation& operation, std::span<const Operation::T> inputs) const;
+
+    // The kernel compiled for the operation and input size, null when there is none
+    std::shared_ptr<const NativeKernel> kernelFor(const Operation& operation, int size) const;
+
+    // Source of the kernel, or why the tree cannot be compiled
+    static std::expected<std::string, std::string> generateSource(const Operation& operation, int size);
+
+private:
+    static constexpr std::uint64_t MAX_NODES = 4096;
+
+    struct Route
+    {
+        std::weak_ptr<Operation> operation; // the key is only valid while it lives
+        std::shared_ptr<NativeKernel> kernel;
+    };
+
+    std::filesystem::path m_cacheDirectory;
+    std::map<std::pair<const Operation*, int>, Route> m_routes;
+};
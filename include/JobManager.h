@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Operation.h"
+#include "ThreadPool.h"
+#include "DetachedTask.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <string>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+class NativeKernel;
+
+// Background evaluations started by 'async'
+// Every job is a coroutine that moves itself onto the thread pool, evaluates
+// its operation there and keeps the result until 'wait' or 'cancel' removes
+// the job, so at most MAX_JOBS jobs are listed at a time. Jobs are submitted,
+// looked up, cancelled and removed from the command thread only, the job itself
+// is what the workers share with it
+// The pool is the manager's own unless one is shared, e.g. by all server sessions
+// A job given the compiled kernel of its operation runs that instead of the
+// interpreter, and falls back to it on a range error like JitCompiler does
+class JobManager
+{
+public:
+    enum class Status
+    {
+        Running,
+        Done,      // finished, with a matrix or a matrix error
+        Failed,    // the evaluation threw
+        Cancelled,
+    };
+
+    class Job
+    {
+    public:
+        Job(std::size_t id, std::shared_ptr<Operation> operation, std::vector<Operation::T> inputs,
+            std::shared_ptr<const NativeKernel> kernel);
+
+        std::size_t id() const { return m_id; }
+        const Operation& operation() const { return *m_operation; }
+        const std::vector<Operation::T>& inputs() const { return m_inputs; }
+
+        Status status() const;
+        // Blocks until the job ends
+        void wait() const;
+        // Asks the job to stop at its next node evaluation
+        void cancel() { m_cancelled = true; }
+
+        // Valid once the job ended
+        const Operation::Result& result() const { return *m_result; }
+        const std::string& failure() const { return m_failure; }
+        double seconds() const { return m_seconds; }
+
+    private:
+        friend class JobManager;
+
+        const std::size_t m_id;
+        const std::shared_ptr<Operation> m_operation;
+        const std::vector<Operation::T> m_inputs;
+        const std::shared_ptr<const NativeKernel> m_kernel; // may be null
+        std::atomic<bool> m_cancelled = false;
+
+        mutable std::mutex m_mutex;
+        mutable std::condition_variable m_finished;
+        std::optional<Operation::Result> m_result;
+        std::string m_failure;
+        double m_seconds = 0;
+
+        void finish(Operation::Result result, std::string failure, double seconds);
+    };
+
+    static constexpr std::size_t MAX_JOBS = 1024;
+
+    JobManager() = default;
+    // Cancels the jobs that still run, and waits for them unless the pool is shared
+    ~JobManager();
+    JobManager(const JobManager&) = delete;
+    JobManager& operator=(const JobManager&) = delete;
+
+    // A pool with the number of workers a manager starts for itself
+    static std::shared_ptr<ThreadPool> makePool();
+    // Runs later jobs on pool instead of a pool of their own
+    void setPool(std::shared_ptr<ThreadPool> pool) { m_pool = std::move(pool); }
+
+    // Requires fewer than MAX_JOBS listed jobs
+    std::size_t submit(std::shared_ptr<Operation> operation, std::vector<Operation::T> inputs,
+        std::shared_ptr<const NativeKernel> kernel = nullptr);
+    std::shared_ptr<Job> find(std::size_t id) const;
+    // Whether the ID was given to a job, which may have been removed since
+    bool wasIssued(std::size_t id) const { return id > 0 && id < m_nextId; }
+    // Forgets the job, a running one keeps running until it notices its cancellation
+    void remove(std::size_t id) { m_jobs.erase(id); }
+    const std::map<std::size_t, std::shared_ptr<Job>>& jobs() const { return m_jobs; }
+
+private:
+    std::map<std::size_t, std::shared_ptr<Job>> m_jobs;
+    std::size_t m_nextId = 1;
+    // At least two workers, so one long job cannot hold up every other one
+    static constexpr unsigned MIN_WORKERS = 2;
+
+    std::shared_ptr<ThreadPool> m_pool; // started by the first job unless shared
+
+    static DetachedTask run(std::shared_ptr<Job> job, ThreadPool& pool);
+};
+
+const char* statusName(JobManager::Status status);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+
+// Lock-free histogram of latencies for percentile counters
+// Every power of two of nanoseconds is split into SUB_BUCKETS buckets, so a
+// percentile is exact below SUB_BUCKETS ns and within ~6% above it
+class LatencyHistogram
+{
+public:
+    void record(std::chrono::nanoseconds latency);
+
+    std::uint64_t count() const;
+    // Upper bound of the bucket that holds the given fraction (0 - 1) of the samples
+    std::chrono::nanoseconds percentile(double fraction) const;
+
+private:
+    static constexpr std::size_t SUB_BITS = 4;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BITS;
+    static constexpr std::size_t BUCKET_COUNT = 64 * SUB_BUCKETS;
+
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> m_buckets{};
+
+    static std::size_t bucketOf(std::uint64_t nanoseconds);
+    static std::uint64_t upperBoundOf(std::size_t bucket);
+};
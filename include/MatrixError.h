@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+
+// Reasons a matrix computation or matrix input can fail
+enum class MatrixErrorCode
+{
+    ComputedOutOfRange,
+    InputOutOfRange,
+    NotANumber,
+    Cancelled,
+    MissingInputs,
+};
+
+// Describes a failed matrix computation without building any text,
+// so the error path stays as cheap as the success path
+struct MatrixError
+{
+    MatrixErrorCode code;
+    int row = 0;
+    int col = 0;
+    long long value = 0;
+    char op = '\0';
+    int inputCount = 0; // MissingInputs: the matrices the operation takes, value holds those given
+};
+
+std::ostream& operator<<(std::ostream& ostr, const MatrixError& error);
+std::string toString(const MatrixError& error);
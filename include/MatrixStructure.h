@@ -0,0 +1,23 @@
+#pragma once
+
+
+// Structure known about a matrix, carried through the operations so they
+// can skip work and keep compact storage for as long as possible
+enum class MatrixStructure
+{
+    General,
+    Symmetric,
+    Diagonal,
+    ScalarIdentity, // a multiple of the identity matrix
+};
+
+inline const char* structureName(MatrixStructure structure)
+{
+    switch (structure)
+    {
+    case MatrixStructure::Symmetric:      return "symmetric";
+    case MatrixStructure::Diagonal:       return "diagonal";
+    case MatrixStructure::ScalarIdentity: return "scalar identity";
+    default:                              return "general";
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+
+// Non-owning, strided view over square matrix storage
+// Transposing a view only swaps its strides, the elements are never copied
+template <typename T>
+class MatrixView
+{
+public:
+    MatrixView(const T* data, int size, int rowStride, int colStride)
+        : m_data(data), m_size(size), m_rowStride(rowStride), m_colStride(colStride) {
+    }
+
+    int size() const { return m_size; }
+    const T& operator()(int i, int j) const
+    {
+        return m_data[static_cast<std::ptrdiff_t>(i) * m_rowStride + static_cast<std::ptrdiff_t>(j) * m_colStride];
+    }
+
+    MatrixView transposed() const { return MatrixView(m_data, m_size, m_colStride, m_rowStride); }
+
+    // True when consecutive elements of a row are adjacent in memory
+    bool isRowMajor() const { return m_colStride == 1; }
+
+private:
+    const T* m_data;
+    int m_size;
+    int m_rowStride;
+    int m_colStride;
+};
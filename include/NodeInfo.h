@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+
+enum class OperationKind : std::uint8_t
+{
+    Identity,
+    Transpose,
+    Scalar,
+    Add,
+    Sub,
+    Comp,
+};
+
+inline const char* kindName(OperationKind kind)
+{
+    switch (kind)
+    {
+    case OperationKind::Identity:  return "identity";
+    case OperationKind::Transpose: return "transpose";
+    case OperationKind::Scalar:    return "scalar";
+    case OperationKind::Add:       return "add";
+    case OperationKind::Sub:       return "sub";
+    default:                       return "comp";
+    }
+}
+
+// Estimated work of one evaluation on n x n matrices
+struct CostEstimate
+{
+    double flops;
+    double bytes;
+};
+
+// Input counts saturate here, no operation with this many inputs can be evaluated
+constexpr int MAX_INPUT_COUNT = std::numeric_limits<int>::max();
+
+// Immutable facts about an operation tree, computed once when the node is built
+// Counts are taken over the tree, so a shared sub-operation counts once per use
+// and large counts saturate at UINT64_MAX (MAX_INPUT_COUNT for the inputs)
+struct NodeInfo
+{
+    OperationKind kind = OperationKind::Identity;
+    int inputCount = 1;
+    int depth = 1;
+    std::uint64_t nodeCount = 1;
+    std::uint64_t hash = 0; // equal for structurally equal trees
+    std::uint64_t opsPerElement = 0;      // arithmetic operations per matrix element
+    std::uint64_t accessesPerElement = 0; // element reads and writes per matrix element
+
+    CostEstimate estimate(int n) const;
+
+    static NodeInfo leaf(OperationKind kind, std::int64_t parameter = 0);
+    static NodeInfo combine(OperationKind kind, const NodeInfo& first, const NodeInfo& second);
+};
@@ -1,9 +1,17 @@
 #pragma once
 
 #include "SquareMatrix.h"
+#include "MatrixError.h"
+#include "NodeInfo.h"
+#include "Profiler.h"
 
 #include <vector>
 #include <iosfwd>
+#include <expected>
+#include <memory>
+#include <span>
+#include <functional>
+#include <cstddef>
 
 
 // Represents an operation on sets
@@ -11,16 +19,51 @@ class Operation
 {
 public:
     using T = SquareMatrix<int>;
+    using Result = std::expected<T, MatrixError>;
+    // Writes child #index of an operation, see printNode()
+    using ChildPrinter = std::function<void(std::ostream& ostr, std::size_t index)>;
+    explicit Operation(const NodeInfo& info);
     virtual ~Operation() = default;
 
     // Return the number of inputs (the range size) expected by compute()
-    virtual int inputCount() const = 0;
+    int inputCount() const { return m_info.inputCount; }
 
-    // Computes the resulted set
-    virtual T compute(const std::vector<T>& input) const =0;
+    // Metadata of the tree rooted at this operation
+    const NodeInfo& info() const { return m_info; }
+
+    // Computes the resulted set, reporting range errors without throwing
+    virtual Result tryCompute(std::span<const T> input) const =0;
+
+    // tryCompute() unless the evaluation on this thread was cancelled, see EvalContext
+    // Operations evaluate their children through it
+    // Fewer than inputCount() matrices are reported as MissingInputs, like the range errors
+    Result evaluate(std::span<const T> input) const;
+
+    // Computes the resulted set, throwing std::invalid_argument on range errors
+    T compute(const std::vector<T>& input) const;
 
     // Prints the operation with generic name for the sets or with the actual input arguments
     virtual void print(std::ostream& ostr, bool first_print = false) const = 0;
 
     virtual void print(std::ostream& ostr, const std::vector<T>& input) const;
+
+    // Prints this operation only, delegating its children to printChild
+    virtual void printNode(std::ostream& ostr, bool first_print, const ChildPrinter& printChild) const;
+
+    // False when the printed form was too long to be cached at construction
+    virtual bool isRenderingCached() const { return true; }
+
+    // The operations this one is built from
+    virtual std::span<const std::shared_ptr<Operation>> children() const { return {}; }
+
+#ifdef FC_ENABLE_PROFILING
+    // Evaluation counters of this node, updated by evaluate()
+    profiling::NodeCounters& counters() const { return m_counters; }
+#endif
+
+private:
+    const NodeInfo m_info;
+#ifdef FC_ENABLE_PROFILING
+    mutable profiling::NodeCounters m_counters;
+#endif
 };
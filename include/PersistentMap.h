@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+
+// Hash map with structurally shared storage, the map counterpart of PersistentVector
+// Entries live in a trie indexed by successive chunks of the key's hash: inner
+// nodes have a child per chunk value, leaves hold a few entries and split once
+// they grow past LEAF_SIZE. Every modification copies only the nodes on the path
+// to the changed entry, so copying the whole map is an O(1) snapshot
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class PersistentMap
+{
+public:
+    PersistentMap() = default;
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    // Null when the key is absent
+    const Value* find(const Key& key) const;
+
+    void set(const Key& key, const Value& value);
+    // Returns false when the key is absent
+    bool erase(const Key& key);
+
+    // True when both maps are the same snapshot, i.e. neither changed since one was copied from the other
+    bool sharesStateWith(const PersistentMap& other) const { return m_root == other.m_root; }
+
+private:
+    static constexpr std::size_t BITS = 5;
+    static constexpr std::size_t CHUNK_SIZE = std::size_t(1) << BITS;
+    static constexpr std::size_t MASK = CHUNK_SIZE - 1;
+    static constexpr std::size_t HASH_BITS = std::numeric_limits<std::size_t>::digits;
+    static constexpr std::size_t LEAF_SIZE = 8;
+
+    struct Entry
+    {
+        std::size_t hash;
+        Key key;
+        Value value;
+    };
+
+    struct Node
+    {
+        std::vector<std::shared_ptr<const Node>> children; // inner nodes, CHUNK_SIZE of them, null when empty
+        std::vector<Entry> entries;                        // leaves
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    NodePtr m_root;
+    std::size_t m_size = 0;
+
+    // added tells whether the key was new
+    static NodePtr setIn(const NodePtr& node, std::size_t shift, const Entry& entry, bool& added);
+    // Returns node itself when the key is absent, null when the node became empty
+    static NodePtr eraseIn(const NodePtr& node, std::size_t shift, std::size_t hash, const Key& key);
+};
+
+template <typename Key, typename Value, typename Hash>
+const Value* PersistentMap<Key, Value, Hash>::find(const Key& key) const
+{
+    const auto hash = Hash()(key);
+    const Node* node = m_root.get();
+    for (std::size_t shift = 0; node && !node->children.empty(); shift += BITS)
+        node = node->children[(hash >> shift) & MASK].get();
+    if (!node)
+        return nullptr;
+
+    for (const auto& entry : node->entries)
+        if (entry.hash == hash && entry.key == key)
+            return &entry.value;
+    return nullptr;
+}
+
+template <typename Key, typename Value, typename Hash>
+void PersistentMap<Key, Value, Hash>::set(const Key& key, const Value& value)
+{
+    bool added = false;
+    m_root = setIn(m_root, 0, Entry{ Hash()(key), key, value }, added);
+    if (added)
+        ++m_size;
+}
+
+template <typename Key, typename Value, typename Hash>
+bool PersistentMap<Key, Value, Hash>::erase(const Key& key)
+{
+    auto root = eraseIn(m_root, 0, Hash()(key), key);
+    if (root == m_root)
+        return false;
+    m_root = std::move(root);
+    --m_size;
+    return true;
+}
+
+template <typename Key, typename Value, typename Hash>
+typename PersistentMap<Key, Value, Hash>::NodePtr PersistentMap<Key, Value, Hash>::setIn(const NodePtr& node,
+    std::size_t shift, const Entry& entry, bool& added)
+{
+    if (!node)
+    {
+        auto leaf = std::make_shared<Node>();
+        leaf->entries.push_back(entry);
+        added = true;
+        return leaf;
+    }
+
+    auto copy = std::make_shared<Node>(*node);
+    if (!copy->children.empty())
+    {
+        auto& child = copy->children[(entry.hash >> shift) & MASK];
+        child = setIn(child, shift + BITS, entry, added);
+        return copy;
+    }
+
+    const auto found = std::find_if(copy->entries.begin(), copy->entries.end(),
+        [&](const Entry& existing) { return existing.hash == entry.hash && existing.key == entry.key; });
+    if (found != copy->entries.end())
+    {
+        found->value = entry.value;
+        return copy;
+    }
+    copy->entries.push_back(entry);
+    added = true;
+    // Once the hash is used up only equal hashes are left, so the leaf just grows
+    if (copy->entries.size() <= LEAF_SIZE || shift >= HASH_BITS)
+        return copy;
+
+    auto inner = std::make_shared<Node>();
+    inner->children.resize(CHUNK_SIZE);
+    for (const auto& moved : copy->entries)
+    {
+        bool ignored = false;
+        auto& child = inner->children[(moved.hash >> shift) & MASK];
+        child = setIn(child, shift + BITS, moved, ignored);
+    }
+    return inner;
+}
+
+template <typename Key, typename Value, typename Hash>
+typename PersistentMap<Key, Value, Hash>::NodePtr PersistentMap<Key, Value, Hash>::eraseIn(const NodePtr& node,
+    std::size_t shift, std::size_t hash, const Key& key)
+{
+    if (!node)
+        return node;
+
+    if (!node->children.empty())
+    {
+        const auto slot = (hash >> shift) & MASK;
+        auto child = eraseIn(node->children[slot], shift + BITS, hash, key);
+        if (child == node->children[slot])
+            return node;
+
+        auto copy = std::make_shared<Node>(*node);
+        copy->children[slot] = std::move(child);
+        if (std::all_of(copy->children.begin(), copy->children.end(), [](const NodePtr& c) { return !c; }))
+            return nullptr;
+        return copy;
+    }
+
+    const auto found = std::find_if(node->entries.begin(), node->entries.end(),
+        [&](const Entry& entry) { return entry.hash == hash && entry.key == key; });
+    if (found == node->entries.end())
+        return node;
+    if (node->entries.size() == 1)
+        return nullptr;
+
+    auto copy = std::make_shared<Node>(*node);
+    copy->entries.erase(copy->entries.begin() + (found - node->entries.begin()));
+    return copy;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+
+// Vector with structurally shared storage
+// Elements live in a tree of fixed size chunks, and every modification copies
+// only the chunks on the path to the changed element. Copying the whole
+// vector is O(1), so a copy works as a snapshot that later changes never touch
+template <typename T>
+class PersistentVector
+{
+public:
+    PersistentVector() = default;
+    // Builds the tree bottom-up in O(n), instead of copying a path per push_back
+    explicit PersistentVector(const std::vector<T>& values);
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T& operator[](std::size_t index) const;
+
+    void push_back(const T& value);
+    void set(std::size_t index, const T& value);
+
+    // True when both vectors are the same snapshot, i.e. neither changed since one was copied from the other
+    bool sharesStateWith(const PersistentVector& other) const
+    {
+        return m_root == other.m_root && m_size == other.m_size;
+    }
+
+private:
+    static constexpr std::size_t BITS = 5;
+    static constexpr std::size_t CHUNK_SIZE = std::size_t(1) << BITS;
+    static constexpr std::size_t MASK = CHUNK_SIZE - 1;
+
+    struct Node
+    {
+        std::vector<std::shared_ptr<const Node>> children; // inner nodes
+        std::vector<T> values;                             // leaves
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    NodePtr m_root;
+    std::size_t m_shift = 0; // bits of the index consumed below the root
+    std::size_t m_size = 0;
+
+    static NodePtr newPath(std::size_t shift, const T& value);
+    static NodePtr pushInto(const NodePtr& node, std::size_t shift, std::size_t index, const T& value);
+    static NodePtr setIn(const NodePtr& node, std::size_t shift, std::size_t index, const T& value);
+};
+
+template <typename T>
+PersistentVector<T>::PersistentVector(const std::vector<T>& values)
+    : m_size(values.size())
+{
+    if (values.empty())
+        return;
+
+    auto level = std::vector<NodePtr>();
+    for (std::size_t i = 0; i < values.size(); i += CHUNK_SIZE)
+    {
+        auto leaf = std::make_shared<Node>();
+        leaf->values.assign(values.begin() + static_cast<std::ptrdiff_t>(i),
+            values.begin() + static_cast<std::ptrdiff_t>(std::min(i + CHUNK_SIZE, values.size())));
+        level.push_back(std::move(leaf));
+    }
+
+    while (level.size() > 1)
+    {
+        auto parents = std::vector<NodePtr>();
+        for (std::size_t i = 0; i < level.size(); i += CHUNK_SIZE)
+        {
+            auto parent = std::make_shared<Node>();
+            parent->children.assign(level.begin() + static_cast<std::ptrdiff_t>(i),
+                level.begin() + static_cast<std::ptrdiff_t>(std::min(i + CHUNK_SIZE, level.size())));
+            parents.push_back(std::move(parent));
+        }
+        level = std::move(parents);
+        m_shift += BITS;
+    }
+    m_root = std::move(level.front());
+}
+
+template <typename T>
+const T& PersistentVector<T>::operator[](std::size_t index) const
+{
+    const Node* node = m_root.get();
+    for (auto shift = m_shift; shift > 0; shift -= BITS)
+        node = node->children[(index >> shift) & MASK].get();
+    return node->values[index & MASK];
+}
+
+template <typename T>
+void PersistentVector<T>::push_back(const T& value)
+{
+    if (!m_root)
+        m_root = newPath(0, value);
+    else if (m_size == (std::size_t(1) << (m_shift + BITS)))
+    {
+        // The tree is full, grow it by one level
+        auto root = std::make_shared<Node>();
+        root->children = { m_root, newPath(m_shift, value) };
+        m_root = std::move(root);
+        m_shift += BITS;
+    }
+    else
+        m_root = pushInto(m_root, m_shift, m_size, value);
+    ++m_size;
+}
+
+template <typename T>
+void PersistentVector<T>::set(std::size_t index, const T& value)
+{
+    m_root = setIn(m_root, m_shift, index, value);
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::newPath(std::size_t shift, const T& value)
+{
+    auto node = std::make_shared<Node>();
+    if (shift == 0)
+        node->values.push_back(value);
+    else
+        node->children.push_back(newPath(shift - BITS, value));
+    return node;
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::pushInto(const NodePtr& node, std::size_t shift,
+    std::size_t index, const T& value)
+{
+    auto copy = std::make_shared<Node>(*node);
+    if (shift == 0)
+    {
+        copy->values.push_back(value);
+        return copy;
+    }
+
+    const auto slot = (index >> shift) & MASK;
+    if (slot < copy->children.size())
+        copy->children[slot] = pushInto(copy->children[slot], shift - BITS, index, value);
+    else
+        copy->children.push_back(newPath(shift - BITS, value));
+    return copy;
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::setIn(const NodePtr& node, std::size_t shift,
+    std::size_t index, const T& value)
+{
+    auto copy = std::make_shared<Node>(*node);
+    if (shift == 0)
+        copy->values[index & MASK] = value;
+    else
+    {
+        const auto slot = (index >> shift) & MASK;
+        copy->children[slot] = setIn(copy->children[slot], shift - BITS, index, value);
+    }
+    return copy;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+
+#ifdef FC_ENABLE_PROFILING
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iosfwd>
+#include <cstdint>
+#endif
+
+class Operation;
+
+
+// Evaluation profiling, compiled in only with FC_ENABLE_PROFILING (CMake
+// option ENABLE_PROFILING). Without it the hooks below are empty inline
+// functions and operations carry no counters, so profiling costs nothing
+namespace profiling
+{
+#ifdef FC_ENABLE_PROFILING
+    constexpr bool ENABLED = true;
+
+    // Evaluations timed exactly per node, after which only every SAMPLE_INTERVAL-th
+    // evaluation of a thread is timed and counted SAMPLE_INTERVAL times; reading
+    // the clock on every call would cost as much as evaluating a small node
+    constexpr std::uint64_t SAMPLE_INTERVAL = 32;
+
+    // Counters of one operation node, summed over all threads
+    // Calls are exact. Time, bytes and copies include the evaluation of the
+    // node's children and are estimated from samples, see SAMPLE_INTERVAL
+    struct NodeCounters
+    {
+        std::atomic<std::uint64_t> calls = 0;
+        std::atomic<std::uint64_t> nanoseconds = 0;
+        std::atomic<std::uint64_t> bytesAllocated = 0;
+        std::atomic<std::uint64_t> matricesCopied = 0;
+
+        void reset();
+    };
+
+    // Process-wide counters of the work around the operation trees
+    struct GlobalCounters
+    {
+        std::atomic<std::uint64_t> renderCacheHits = 0;
+        std::atomic<std::uint64_t> renderCacheMisses = 0;
+        std::atomic<std::uint64_t> parsedMatrices = 0;
+        std::atomic<std::uint64_t> parseNanoseconds = 0;
+        std::atomic<std::uint64_t> formattedResults = 0;
+        std::atomic<std::uint64_t> formatNanoseconds = 0;
+
+        void reset();
+    };
+
+    GlobalCounters& globalCounters();
+
+    // Matrix storage allocated and copied by the current thread, read by NodeScope
+    struct ThreadCounters
+    {
+        std::uint64_t bytesAllocated = 0;
+        std::uint64_t matricesCopied = 0;
+    };
+
+    inline thread_local ThreadCounters t_threadCounters;
+
+    inline void recordAllocation(std::size_t bytes)
+    {
+        t_threadCounters.bytesAllocated += bytes;
+    }
+
+    inline void recordCopy(std::size_t bytes)
+    {
+        t_threadCounters.bytesAllocated += bytes;
+        ++t_threadCounters.matricesCopied;
+    }
+
+    inline void recordRenderCache(bool hit)
+    {
+        (hit ? globalCounters().renderCacheHits : globalCounters().renderCacheMisses).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    struct TraceEvent
+    {
+        const Operation* node;
+        std::uint64_t startNanoseconds;
+        std::uint64_t durationNanoseconds;
+        int depth;
+    };
+
+    // Records every node evaluation of the current thread while it lives
+    class TraceRecorder
+    {
+    public:
+        TraceRecorder();
+        ~TraceRecorder();
+        TraceRecorder(const TraceRecorder&) = delete;
+        TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+        const std::vector<TraceEvent>& events() const { return m_events; }
+        // Chrome trace-event JSON, viewable in chrome://tracing or Perfetto
+        void writeChromeTrace(std::ostream& ostr) const;
+
+    private:
+        friend class NodeScope;
+
+        std::chrono::steady_clock::time_point m_origin;
+        std::vector<TraceEvent> m_events;
+        int m_depth = 0;
+        TraceRecorder* m_previous;
+
+        inline static thread_local TraceRecorder* t_current = nullptr;
+    };
+
+    // Times one node evaluation into the node's counters and the active trace
+    class NodeScope
+    {
+    public:
+        NodeScope(const Operation& node, NodeCounters& counters);
+        ~NodeScope();
+        NodeScope(const NodeScope&) = delete;
+        NodeScope& operator=(const NodeScope&) = delete;
+
+    private:
+        NodeCounters& m_counters;
+        std::uint64_t m_weight = 0; // 0 when this evaluation is not sampled
+        TraceRecorder* m_trace;
+        std::chrono::steady_clock::time_point m_start;
+        ThreadCounters m_before;
+        std::size_t m_traceIndex = 0;
+
+        inline static thread_local std::uint64_t t_sampleTick = 0;
+    };
+
+    // Adds its own lifetime to a nanosecond counter
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(std::atomic<std::uint64_t>& target);
+        ~ScopedTimer();
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        std::atomic<std::uint64_t>& m_target;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Short name of a node for reports: its tree form when short enough, else its kind and hash
+    std::string nodeLabel(const Operation& node);
+    // Calls, time, bytes and copies of every distinct node of the tree
+    void printNodeStats(std::ostream& ostr, const Operation& root);
+    void resetNodeStats(const Operation& root);
+#else
+    constexpr bool ENABLED = false;
+
+    inline void recordAllocation(std::size_t) {}
+    inline void recordCopy(std::size_t) {}
+    inline void recordRenderCache(bool) {}
+#endif
+}
@@ -1,11 +1,11 @@
 #pragma once
 
 #include "FunctionCalculator.h"
+#include "Tokenizer.h"
 #include <string>
-#include <istream>
 
 class ReadCommand
 {
 public:
-    static void run(FunctionCalculator& calc, std::istream& args);
+    static void run(FunctionCalculator& calc, Tokenizer& args);
 };
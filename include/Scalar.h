@@ -10,8 +10,9 @@ class Scalar : public UnaryOperation
 {
 public:
     Scalar(int scalar);
-    T compute(const std::vector<T>& input) const override;
+    Result tryCompute(std::span<const T> input) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
+    int scalar() const { return m_scalar; }
 
 private:
     int m_scalar;
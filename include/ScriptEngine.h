@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <iosfwd>
+#include <cstring>
+#include <cstddef>
+
+class FunctionCalculator;
+
+
+// What a script run does when a command fails
+enum class ErrorPolicy
+{
+    Abort,   // report the error and stop
+    Skip,    // report the error and go on with the next line
+    Collect, // go on silently, the errors are returned in the report
+};
+
+// Accepts "abort", "skip" or "collect"
+std::optional<ErrorPolicy> parseErrorPolicy(std::string_view name);
+
+struct ScriptError
+{
+    std::size_t line;
+    std::string message;
+};
+
+struct ScriptReport
+{
+    std::size_t commands = 0; // non-blank lines executed, failed ones included
+    std::size_t failed = 0;
+    bool aborted = false;
+    double seconds = 0;
+    std::vector<ScriptError> errors; // only filled under ErrorPolicy::Collect
+
+    double commandsPerSecond() const { return seconds > 0 ? static_cast<double>(commands) / seconds : 0; }
+};
+
+// Prints "N commands in X ms (Y commands/s), F failed"
+std::ostream& operator<<(std::ostream& ostr, const ScriptReport& report);
+
+
+// Runs command scripts through a calculator without any user interaction:
+// the calculator asks no questions and prints no prompts while the engine
+// lives, and errors are handled by the policy instead of asking the user
+// Files are memory mapped and split in place, no line is copied
+class ScriptEngine
+{
+public:
+    // Errors reported by the Abort and Skip policies are written to errors
+    ScriptEngine(FunctionCalculator& calculator, ErrorPolicy policy, std::ostream& errors);
+    ~ScriptEngine();
+    ScriptEngine(const ScriptEngine&) = delete;
+    ScriptEngine& operator=(const ScriptEngine&) = delete;
+
+    ScriptReport runFile(const std::string& path);
+    ScriptReport runText(std::string_view script);
+
+    // Calls func(line, lineNumber) for every line, without the line break,
+    // until func returns false
+    template <typename Func>
+    static void forEachLine(std::string_view text, Func func);
+
+private:
+    FunctionCalculator& m_calculator;
+    ErrorPolicy m_policy;
+    std::ostream& m_errors;
+    bool m_wasInteractive;
+};
+
+template <typename Func>
+void ScriptEngine::forEachLine(std::string_view text, Func func)
+{
+    for (std::size_t lineNumber = 1; !text.empty(); ++lineNumber)
+    {
+        const auto* end = static_cast<const char*>(std::memchr(text.data(), '\n', text.size()));
+        const auto length = end ? static_cast<std::size_t>(end - text.data()) : text.size();
+
+        auto line = text.substr(0, length);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        text.remove_prefix(end ? length + 1 : length);
+
+        if (!func(line, lineNumber))
+            return;
+    }
+}
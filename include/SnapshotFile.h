@@ -0,0 +1,21 @@
+#pragma once
+
+#include "FunctionCalculator.h"
+
+#include <string>
+
+
+// Binary file holding a function list and its capacity
+// Every distinct operation node is written once, children before parents,
+// so sub-operations shared in memory are shared again after loading
+// Layout (little endian): magic, version, payload size, FNV-1a checksum of
+// the payload, then the capacity, the nodes and the registry slots
+class SnapshotFile
+{
+public:
+    static constexpr std::uint32_t VERSION = 1;
+
+    static void save(const std::string& path, const FunctionCalculator::Snapshot& state);
+    // Throws std::invalid_argument when the file is missing, corrupt or of another version
+    static FunctionCalculator::Snapshot load(const std::string& path);
+};
@@ -1,18 +1,49 @@
 #pragma once
 
+#include "MatrixError.h"
+#include "MatrixView.h"
+#include "MatrixStructure.h"
+#include "CsrMatrix.h"
+#include "Profiler.h"
+
 #include <vector>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <expected>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+#include <optional>
 
 constexpr int MAX_MAT_SIZE = 5;
 constexpr int MAX_ALLOWED_VALUE = 1000;
 constexpr int MIN_ALLOWED_VALUE = -1024;
 
+// Tile edge used when the operands of a kernel are stored in different orders
+constexpr int MATRIX_BLOCK_SIZE = 32;
+
+// Input matrices of at least SPARSE_MIN_SIZE rows with at most SPARSE_LOAD_DENSITY
+// non-zeros are stored in CSR form; results return to dense storage
+// once they fill more than SPARSE_MAX_DENSITY of their elements
+constexpr int SPARSE_MIN_SIZE = 64;
+constexpr double SPARSE_LOAD_DENSITY = 0.01;
+constexpr double SPARSE_MAX_DENSITY = 0.1;
+
+// Square matrix with shared, copy-on-write storage
+// Copies and transposes are O(1): they share the element buffer and
+// the buffer is only duplicated when a shared matrix is written to
+// Diagonal and scalar identity matrices only store their n diagonal elements,
+// and large mostly zero matrices use the CsrMatrix backend
+// Dense storage is materialized once an operation loses that structure
 template <typename T>
 class SquareMatrix
 {
 public:
+    using Result = std::expected<SquareMatrix, MatrixError>;
+
     SquareMatrix(const SquareMatrix&) = default;
     SquareMatrix(SquareMatrix&&) = default;
     SquareMatrix& operator=(const SquareMatrix&) = default;
@@ -21,11 +52,33 @@ public:
 
     SquareMatrix(int size, const T& value);
     SquareMatrix(int size);
+    explicit SquareMatrix(const MatrixView<T>& view);
+
+    // Declares the structure up front instead of detecting it
+    static SquareMatrix diagonal(std::vector<T> values);
+    static SquareMatrix scalarIdentity(int size, const T& value);
 
     int size() const { return m_size; }
     T& operator()(int i, int j);
     const T& operator()(int i, int j) const;
 
+    MatrixStructure structure() const { return m_structure; }
+    bool isDense() const { return !isCompact() && !isSparse(); }
+    bool isSparse() const { return m_sparse != nullptr; }
+    // Scans the elements and switches to compact or sparse storage when possible
+    void detectStructure();
+    SquareMatrix toDense() const;
+
+    // Only valid for dense storage
+    MatrixView<T> view() const;
+    bool isTransposed() const { return m_transposed; }
+
+    // Non-throwing kernels, reporting the first out of range element
+    Result tryAdd(const SquareMatrix& rhs) const;
+    Result trySub(const SquareMatrix& rhs) const;
+    Result tryScale(const T& scalar) const;
+
+    // Throwing wrappers around the kernels above
     SquareMatrix& operator+=(const SquareMatrix& rhs);
     SquareMatrix& operator-=(const SquareMatrix& rhs);
     SquareMatrix operator+(const SquareMatrix& rhs) const;
@@ -35,25 +88,109 @@ public:
 
 private:
     int m_size;
-    std::vector<std::vector<T>> m_matrix;
+    std::shared_ptr<std::vector<T>> m_data; // null when the matrix is sparse
+    std::shared_ptr<const CsrMatrix<T>> m_sparse;
+    bool m_transposed = false;
+    MatrixStructure m_structure = MatrixStructure::General;
+
+    using Wide = WideElement<T>;
+    static_assert(!std::is_integral_v<T> || sizeof(T) < sizeof(Wide),
+        "SquareMatrix element type must be narrower than long long");
 
-    void validateMatrixRange() const;
+    bool isCompact() const
+    {
+        return m_structure == MatrixStructure::Diagonal || m_structure == MatrixStructure::ScalarIdentity;
+    }
+
+    std::size_t offset(int i, int j) const;
+    void detach();
+    static const T& zero() { static const T value{}; return value; }
+
+    // Builds a new matrix from func(a, b) applied to matching elements,
+    // range checking every element as it is written
+    template <typename Func>
+    Result combine(const SquareMatrix& rhs, char op, Func func) const;
+    template <typename Func>
+    Result combineDiagonals(const SquareMatrix& rhs, char op, Func func) const;
+    template <typename Func>
+    Result combineSparse(const SquareMatrix& rhs, char op, Func func) const;
+
+    std::shared_ptr<const CsrMatrix<T>> toSparse() const;
+    static Result fromSparse(typename CsrMatrix<T>::Result&& sparse, MatrixStructure structure);
+
+    static bool inRange(Wide value) { return value >= MIN_ALLOWED_VALUE && value <= MAX_ALLOWED_VALUE; }
+    static SquareMatrix unwrap(Result&& result);
 };
 
+template <typename T>
+std::size_t SquareMatrix<T>::offset(int i, int j) const
+{
+    return m_transposed
+        ? static_cast<std::size_t>(j) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(i)
+        : static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(j);
+}
+
 template <typename T>
 const T& SquareMatrix<T>::operator()(int i, int j) const
 {
-    return m_matrix[i][j];
+    if (isCompact())
+        return i == j ? (*m_data)[static_cast<std::size_t>(i)] : zero();
+    if (isSparse())
+    {
+        const T* value = m_sparse->find(i, j);
+        return value ? *value : zero();
+    }
+    return (*m_data)[offset(i, j)];
 }
 
+// Writing through an element reference may break any structure, so the
+// matrix falls back to private, dense and general storage
 template <typename T>
 T& SquareMatrix<T>::operator()(int i, int j)
 {
-    return m_matrix[i][j];
+    if (!isDense())
+        *this = toDense();
+    m_structure = MatrixStructure::General;
+    detach();
+    return (*m_data)[offset(i, j)];
+}
+
+template <typename T>
+MatrixView<T> SquareMatrix<T>::view() const
+{
+    const auto rowMajor = MatrixView<T>(m_data->data(), m_size, m_size, 1);
+    return m_transposed ? rowMajor.transposed() : rowMajor;
+}
+
+// Gives this matrix a private copy of its elements before it is modified
+template <typename T>
+void SquareMatrix<T>::detach()
+{
+    if (m_data.use_count() > 1)
+    {
+        profiling::recordCopy(m_data->size() * sizeof(T));
+        m_data = std::make_shared<std::vector<T>>(*m_data);
+    }
+}
+
+inline std::ostream& operator<<(std::ostream& ostr, const MatrixView<int>& matrix)
+{
+    for (int i = 0; i < matrix.size(); ++i)
+    {
+        for (int j = 0; j < matrix.size(); ++j)
+        {
+            ostr << matrix(i, j) << ' ';
+        }
+        ostr << '\n';
+    }
+    return ostr;
 }
 
 inline std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<int>& matrix)
 {
+    if (matrix.isDense())
+        return ostr << matrix.view();
+
     for (int i = 0; i < matrix.size(); ++i)
     {
         for (int j = 0; j < matrix.size(); ++j)
@@ -65,126 +202,347 @@ inline std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<int>& mat
     return ostr;
 }
 
-inline std::istream& operator>>(std::istream& istr, SquareMatrix<int>& matrix)
+// Fills matrix.size() x matrix.size() elements from nextValue(), which returns
+// std::optional<int>, reporting the first invalid element
+template <typename NextValue>
+std::expected<void, MatrixError> tryParseMatrix(NextValue nextValue, SquareMatrix<int>& matrix)
 {
     for (int i = 0; i < matrix.size(); ++i)
     {
         for (int j = 0; j < matrix.size(); ++j)
         {
-            int value;
-            istr >> value;
+            const std::optional<int> value = nextValue();
 
-            if (!istr)
-                throw std::invalid_argument("Expected numeric matrix element.");
+            if (!value)
+                return std::unexpected(MatrixError{ MatrixErrorCode::NotANumber, i, j });
 
-            if (value < MIN_ALLOWED_VALUE || value > MAX_ALLOWED_VALUE)
-                throw std::invalid_argument(
-                    "Matrix element out of allowed range [" +
-                    std::to_string(MIN_ALLOWED_VALUE) + ", " +
-                    std::to_string(MAX_ALLOWED_VALUE) + "]");
+            if (*value < MIN_ALLOWED_VALUE || *value > MAX_ALLOWED_VALUE)
+                return std::unexpected(MatrixError{ MatrixErrorCode::InputOutOfRange, i, j, *value });
 
-            matrix(i, j) = value;
+            matrix(i, j) = *value;
         }
     }
+    matrix.detectStructure();
+    return {};
+}
+
+// Reads matrix.size() x matrix.size() elements, reporting the first invalid one
+inline std::expected<void, MatrixError> tryReadMatrix(std::istream& istr, SquareMatrix<int>& matrix)
+{
+    return tryParseMatrix([&istr]() -> std::optional<int>
+        {
+            int value;
+            if (istr >> value)
+                return value;
+            return {};
+        }, matrix);
+}
+
+inline std::istream& operator>>(std::istream& istr, SquareMatrix<int>& matrix)
+{
+    if (auto result = tryReadMatrix(istr, matrix); !result)
+        throw std::invalid_argument(toString(result.error()));
     return istr;
 }
 
 template <typename T>
 SquareMatrix<T>::SquareMatrix(int size, const T& value)
-    : m_size(size), m_matrix(size, std::vector<T>(size, value)) {
+    : m_size(size),
+      m_data(std::make_shared<std::vector<T>>(static_cast<std::size_t>(size) * static_cast<std::size_t>(size), value)) {
+    profiling::recordAllocation(m_data->size() * sizeof(T));
 }
 
 template <typename T>
 SquareMatrix<T>::SquareMatrix(int size)
-    : m_size(size), m_matrix(size, std::vector<T>(size)) {
+    : SquareMatrix(size, T()) {
 }
 
 template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator+(const SquareMatrix& rhs) const
+SquareMatrix<T>::SquareMatrix(const MatrixView<T>& view)
+    : SquareMatrix(view.size())
 {
-    SquareMatrix result(*this);
-    result += rhs;
+    auto& data = *m_data;
+    for (int i = 0; i < m_size; ++i)
+        for (int j = 0; j < m_size; ++j)
+            data[offset(i, j)] = view(i, j);
+}
+
+template <typename T>
+SquareMatrix<T> SquareMatrix<T>::diagonal(std::vector<T> values)
+{
+    auto result = SquareMatrix(0);
+    result.m_size = static_cast<int>(values.size());
+    profiling::recordAllocation(values.size() * sizeof(T));
+    result.m_data = std::make_shared<std::vector<T>>(std::move(values));
+    result.m_structure = MatrixStructure::Diagonal;
     return result;
 }
 
 template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator-(const SquareMatrix& rhs) const
+SquareMatrix<T> SquareMatrix<T>::scalarIdentity(int size, const T& value)
 {
-    SquareMatrix result(*this);
-    result -= rhs;
+    auto result = diagonal(std::vector<T>(static_cast<std::size_t>(size), value));
+    result.m_structure = MatrixStructure::ScalarIdentity;
     return result;
 }
 
 template <typename T>
-SquareMatrix<T>& SquareMatrix<T>::operator+=(const SquareMatrix& rhs)
+void SquareMatrix<T>::detectStructure()
 {
-    for (int i = 0; i < m_size; ++i)
+    if (!isDense())
+        return;
+
+    const auto& self = *this;
+    bool isDiagonal = true;
+    bool isSymmetric = true;
+    for (int i = 0; i < m_size && (isDiagonal || isSymmetric); ++i)
     {
-        for (int j = 0; j < m_size; ++j)
+        for (int j = i + 1; j < m_size; ++j)
         {
-            m_matrix[i][j] += rhs.m_matrix[i][j];
+            const T& upper = self(i, j);
+            const T& lower = self(j, i);
+            isSymmetric = isSymmetric && upper == lower;
+            isDiagonal = isDiagonal && upper == zero() && lower == zero();
         }
     }
-    validateMatrixRange();  // 
-    return *this;
+
+    if (isDiagonal)
+    {
+        std::vector<T> values(static_cast<std::size_t>(m_size));
+        for (int i = 0; i < m_size; ++i)
+            values[static_cast<std::size_t>(i)] = self(i, i);
+        const bool isScalar = std::ranges::adjacent_find(values, std::ranges::not_equal_to()) == values.end();
+        *this = diagonal(std::move(values));
+        if (isScalar)
+            m_structure = MatrixStructure::ScalarIdentity;
+    }
+    else if (isSymmetric)
+        m_structure = MatrixStructure::Symmetric;
+
+    const double cells = static_cast<double>(m_size) * static_cast<double>(m_size);
+    if (isDense() && m_size >= SPARSE_MIN_SIZE
+        && static_cast<double>(CsrMatrix<T>::countNonZeros(view())) <= SPARSE_LOAD_DENSITY * cells)
+    {
+        m_sparse = std::make_shared<const CsrMatrix<T>>(CsrMatrix<T>::fromView(view()));
+        m_data = nullptr;
+        m_transposed = false;
+    }
 }
 
 template <typename T>
-SquareMatrix<T>& SquareMatrix<T>::operator-=(const SquareMatrix& rhs)
+SquareMatrix<T> SquareMatrix<T>::toDense() const
 {
-    for (int i = 0; i < m_size; ++i)
+    if (isDense())
+        return *this;
+
+    auto result = SquareMatrix(m_size);
+    if (isSparse())
     {
-        for (int j = 0; j < m_size; ++j)
-        {
-            m_matrix[i][j] -= rhs.m_matrix[i][j];
-        }
+        m_sparse->copyTo(result.m_data->data());
+        result.m_structure = m_structure;
+        return result;
     }
-    validateMatrixRange();  // 
-    return *this;
+
+    for (int i = 0; i < m_size; ++i)
+        (*result.m_data)[result.offset(i, i)] = (*m_data)[static_cast<std::size_t>(i)];
+    result.m_structure = MatrixStructure::Symmetric;
+    return result;
 }
 
+// O(n) kernel for two matrices that only store their diagonals
 template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator*(const T& scalar) const
+template <typename Func>
+typename SquareMatrix<T>::Result SquareMatrix<T>::combineDiagonals(const SquareMatrix& rhs, char op, Func func) const
 {
-    SquareMatrix result(*this);
-    for (int i = 0; i < m_size; ++i)
+    std::vector<T> values(m_data->size());
+    for (std::size_t k = 0; k < values.size(); ++k)
     {
-        for (int j = 0; j < m_size; ++j)
-        {
-            result(i, j) *= scalar;
-        }
+        const Wide value = func(Wide((*m_data)[k]), Wide((*rhs.m_data)[k]));
+        if (!inRange(value))
+            return std::unexpected(MatrixError{ MatrixErrorCode::ComputedOutOfRange, static_cast<int>(k),
+                static_cast<int>(k), static_cast<long long>(value), op });
+        values[k] = static_cast<T>(value);
     }
-    result.validateMatrixRange();  // 
+
+    auto result = diagonal(std::move(values));
+    if (m_structure == MatrixStructure::ScalarIdentity && rhs.m_structure == MatrixStructure::ScalarIdentity)
+        result.m_structure = MatrixStructure::ScalarIdentity;
     return result;
 }
 
 template <typename T>
-SquareMatrix<T> SquareMatrix<T>::Transpose() const
+std::shared_ptr<const CsrMatrix<T>> SquareMatrix<T>::toSparse() const
 {
-    SquareMatrix result(m_size);
-    for (int i = 0; i < m_size; ++i)
-    {
-        for (int j = 0; j < m_size; ++j)
-        {
-            result(i, j) = m_matrix[j][i];
-        }
-    }
+    if (isSparse())
+        return m_sparse;
+    if (isCompact())
+        return std::make_shared<const CsrMatrix<T>>(CsrMatrix<T>::fromDiagonal(*m_data));
+    return std::make_shared<const CsrMatrix<T>>(CsrMatrix<T>::fromView(view()));
+}
+
+template <typename T>
+typename SquareMatrix<T>::Result SquareMatrix<T>::fromSparse(typename CsrMatrix<T>::Result&& sparse,
+    MatrixStructure structure)
+{
+    if (!sparse)
+        return std::unexpected(sparse.error());
+
+    auto result = SquareMatrix(0);
+    result.m_size = sparse->size();
+    result.m_data = nullptr;
+    result.m_sparse = std::make_shared<const CsrMatrix<T>>(std::move(*sparse));
+    result.m_structure = structure;
+    if (result.m_sparse->density() > SPARSE_MAX_DENSITY)
+        return result.toDense();
     return result;
 }
 
+// Row merge of two operands that are sparse, or sparse and diagonal
 template <typename T>
-void SquareMatrix<T>::validateMatrixRange() const
+template <typename Func>
+typename SquareMatrix<T>::Result SquareMatrix<T>::combineSparse(const SquareMatrix& rhs, char op, Func func) const
 {
-    for (int i = 0; i < m_size; ++i)
+    const bool symmetric = m_structure != MatrixStructure::General && rhs.m_structure != MatrixStructure::General;
+    return fromSparse(toSparse()->merge(*rhs.toSparse(), op, func, &SquareMatrix::inRange),
+        symmetric ? MatrixStructure::Symmetric : MatrixStructure::General);
+}
+
+template <typename T>
+template <typename Func>
+typename SquareMatrix<T>::Result SquareMatrix<T>::combine(const SquareMatrix& rhs, char op, Func func) const
+{
+    if (isCompact() && rhs.isCompact())
+        return combineDiagonals(rhs, op, func);
+    if (!isDense() && !rhs.isDense())
+        return combineSparse(rhs, op, func);
+    if (!isDense())
+        return toDense().combine(rhs, op, func);
+    if (!rhs.isDense())
+        return combine(rhs.toDense(), op, func);
+
+    const auto n = static_cast<std::size_t>(m_size);
+    auto result = SquareMatrix(m_size);
+    auto& out = *result.m_data;
+    if (m_structure == MatrixStructure::Symmetric && rhs.m_structure == MatrixStructure::Symmetric)
+        result.m_structure = MatrixStructure::Symmetric;
+    const auto& lhsData = *m_data;
+    const auto& rhsData = *rhs.m_data;
+
+    // Same storage order: a single linear pass, the result keeps that order
+    if (m_transposed == rhs.m_transposed)
     {
-        for (int j = 0; j < m_size; ++j)
+        result.m_transposed = m_transposed;
+        for (std::size_t k = 0; k < out.size(); ++k)
+        {
+            const Wide value = func(Wide(lhsData[k]), Wide(rhsData[k]));
+            if (!inRange(value))
+            {
+                const auto row = static_cast<int>(m_transposed ? k % n : k / n);
+                const auto col = static_cast<int>(m_transposed ? k / n : k % n);
+                return std::unexpected(MatrixError{ MatrixErrorCode::ComputedOutOfRange, row, col,
+                    static_cast<long long>(value), op });
+            }
+            out[k] = static_cast<T>(value);
+        }
+        return result;
+    }
+
+    // Mixed storage order: walk tiles so the strided operand stays in cache
+    const auto lhs = view();
+    const auto other = rhs.view();
+    for (int ii = 0; ii < m_size; ii += MATRIX_BLOCK_SIZE)
+    {
+        for (int jj = 0; jj < m_size; jj += MATRIX_BLOCK_SIZE)
         {
-            const T& val = m_matrix[i][j];
-            if (val < MIN_ALLOWED_VALUE || val > MAX_ALLOWED_VALUE)
-                throw std::invalid_argument(
-                    "Computed matrix value out of range [" +
-                    std::to_string(MIN_ALLOWED_VALUE) + ", " +
-                    std::to_string(MAX_ALLOWED_VALUE) + "]");
+            const int iEnd = std::min(ii + MATRIX_BLOCK_SIZE, m_size);
+            const int jEnd = std::min(jj + MATRIX_BLOCK_SIZE, m_size);
+            for (int i = ii; i < iEnd; ++i)
+            {
+                for (int j = jj; j < jEnd; ++j)
+                {
+                    const Wide value = func(Wide(lhs(i, j)), Wide(other(i, j)));
+                    if (!inRange(value))
+                        return std::unexpected(MatrixError{ MatrixErrorCode::ComputedOutOfRange, i, j,
+                            static_cast<long long>(value), op });
+                    out[result.offset(i, j)] = static_cast<T>(value);
+                }
+            }
         }
     }
+    return result;
+}
+
+template <typename T>
+typename SquareMatrix<T>::Result SquareMatrix<T>::tryAdd(const SquareMatrix& rhs) const
+{
+    return combine(rhs, '+', [](Wide a, Wide b) { return a + b; });
+}
+
+template <typename T>
+typename SquareMatrix<T>::Result SquareMatrix<T>::trySub(const SquareMatrix& rhs) const
+{
+    return combine(rhs, '-', [](Wide a, Wide b) { return a - b; });
+}
+
+template <typename T>
+typename SquareMatrix<T>::Result SquareMatrix<T>::tryScale(const T& scalar) const
+{
+    if (isSparse())
+        return fromSparse(m_sparse->scaled(scalar, &SquareMatrix::inRange), m_structure);
+    return combine(*this, '*', [&](Wide a, Wide) { return a * Wide(scalar); });
+}
+
+template <typename T>
+SquareMatrix<T> SquareMatrix<T>::unwrap(Result&& result)
+{
+    if (!result)
+        throw std::invalid_argument(toString(result.error()));
+    return std::move(*result);
+}
+
+template <typename T>
+SquareMatrix<T> SquareMatrix<T>::operator+(const SquareMatrix& rhs) const
+{
+    return unwrap(tryAdd(rhs));
+}
+
+template <typename T>
+SquareMatrix<T> SquareMatrix<T>::operator-(const SquareMatrix& rhs) const
+{
+    return unwrap(trySub(rhs));
+}
+
+// The compound operators only assign a fully validated result,
+// so a failed operation never leaves a wrapped value behind
+template <typename T>
+SquareMatrix<T>& SquareMatrix<T>::operator+=(const SquareMatrix& rhs)
+{
+    return *this = unwrap(tryAdd(rhs));
+}
+
+template <typename T>
+SquareMatrix<T>& SquareMatrix<T>::operator-=(const SquareMatrix& rhs)
+{
+    return *this = unwrap(trySub(rhs));
+}
+
+template <typename T>
+SquareMatrix<T> SquareMatrix<T>::operator*(const T& scalar) const
+{
+    return unwrap(tryScale(scalar));
+}
+
+// Shares the elements and only flips the storage order,
+// a symmetric or diagonal matrix is its own transpose
+template <typename T>
+SquareMatrix<T> SquareMatrix<T>::Transpose() const
+{
+    SquareMatrix result(*this);
+    if (m_structure != MatrixStructure::General)
+        return result;
+    if (isSparse())
+        result.m_sparse = std::make_shared<const CsrMatrix<T>>(m_sparse->transposed());
+    else
+        result.m_transposed = !m_transposed;
+    return result;
 }
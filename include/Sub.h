@@ -8,8 +8,8 @@
 class Sub : public BinaryOperation
 {
 public:
-    using BinaryOperation::BinaryOperation;
-    T compute(const std::vector<T>& input) const override;
+    Sub(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2);
+    Result tryCompute(std::span<const T> input) const override;
     void printSymbol(std::ostream& ostr) const override;
 
 };
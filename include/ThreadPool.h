@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+
+
+// Fixed set of worker threads running posted work in FIFO order
+// The destructor runs the work still queued, then joins the workers
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency()));
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void post(std::function<void()> work);
+
+    // "co_await pool.schedule()" resumes the coroutine on a worker thread
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            ThreadPool& pool;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { pool.post([handle] { handle.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+
+    void work();
+};
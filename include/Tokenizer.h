@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+#include <optional>
+#include <cstddef>
+
+
+// Splits a command line into whitespace separated tokens
+// The tokens are views into the line, nothing is copied or allocated
+class Tokenizer
+{
+public:
+    explicit Tokenizer(std::string_view line);
+
+    // Returns the next token, or an empty view when the line is exhausted
+    std::string_view next();
+    std::optional<int> nextInt();
+
+    // Number of tokens left, without consuming them
+    std::size_t remaining() const;
+    bool atEnd() const;
+
+private:
+    std::string_view m_rest;
+
+    void skipSpaces();
+};
@@ -9,8 +9,8 @@
 class Transpose : public UnaryOperation
 {
 public:
-    using UnaryOperation::UnaryOperation;
-    T compute(const std::vector<T>& input) const override;
+    Transpose();
+    Result tryCompute(std::span<const T> input) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 };
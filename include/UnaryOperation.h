@@ -3,13 +3,13 @@
 #include "Operation.h"
 
 #include <memory>
+#include <cstdint>
 
 
 class UnaryOperation : public Operation
 {
 public:
-    UnaryOperation();
-    int inputCount() const override;
+    explicit UnaryOperation(OperationKind kind, std::int64_t parameter = 0);
     ~UnaryOperation() override = 0
     {
     }
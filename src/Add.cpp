@@ -3,15 +3,25 @@
 #include <iostream>
 
 
-Operation::T Add::compute(const std::vector<T>& input) const
+Add::Add(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2)
+    : BinaryOperation(OperationKind::Add, arg1, arg2)
 {
-    const auto a = first()->compute(input);
-    auto firstCount = first()->inputCount();
-	//remove the firstCount elements from the input vector, and put in a new vector
-	std::vector input2(input.begin() + firstCount, input.end());
-    const auto b = second()->compute(input2);
+    cacheRendering();
+}
+
+
+Operation::Result Add::tryCompute(std::span<const T> input) const
+{
+    const auto a = first()->evaluate(input);
+    if (!a)
+        return a;
+    // the second operation takes the inputs after the first operation's ones
+    const auto firstCount = static_cast<std::size_t>(first()->inputCount());
+    const auto b = second()->evaluate(input.subspan(firstCount));
+    if (!b)
+        return b;
 
-    return a + b;
+    return a->tryAdd(*b);
 }
 
 
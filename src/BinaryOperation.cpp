@@ -1,23 +1,57 @@
 #include "BinaryOperation.h"
 
 #include <iostream>
+#include <sstream>
 
 
-BinaryOperation::BinaryOperation(const std::shared_ptr<Operation>& first, const std::shared_ptr<Operation>& second)
-    : m_first(first), m_second(second)
+BinaryOperation::BinaryOperation(OperationKind kind, const std::shared_ptr<Operation>& first,
+    const std::shared_ptr<Operation>& second)
+    : Operation(NodeInfo::combine(kind, first->info(), second->info())), m_children{ first, second }
 {
 }
 
 
+void BinaryOperation::cacheRendering()
+{
+    if (!first()->isRenderingCached() || !second()->isRenderingCached())
+        return;
+
+    std::ostringstream ostr;
+    print(ostr, true);
+    if (ostr.tellp() > static_cast<std::streamoff>(RENDER_CACHE_LIMIT))
+        return;
+
+    m_rendering = std::move(ostr).str();
+    m_isRenderingCached = true;
+}
+
+
 void BinaryOperation::print(std::ostream& ostr, bool first_print ) const
+{
+    profiling::recordRenderCache(m_isRenderingCached);
+    if (m_isRenderingCached)
+    {
+        if (!first_print)
+            ostr << '(';
+        ostr << m_rendering;
+        if (!first_print)
+            ostr << ')';
+        return;
+    }
+
+    printNode(ostr, first_print, [this](std::ostream& out, std::size_t index) { children()[index]->print(out); });
+}
+
+
+void BinaryOperation::printNode(std::ostream& ostr, bool first_print, const ChildPrinter& printChild) const
 {
     if (!first_print)
         ostr << '(';
-    first()->print(ostr);
+    printChild(ostr, 0);
     ostr << ' ';
     printSymbol(ostr);
     ostr << ' ';
-    second()->print(ostr);
+    printChild(ostr, 1);
     if (!first_print)
         ostr << ')';
 }
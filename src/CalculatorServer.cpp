@@ -0,0 +1,272 @@
+#include "CalculatorServer.h"
+#include "Tokenizer.h"
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+// A client's own calculator, its output buffer and view settings
+// The registry it works on is replaced by the shared snapshot before every command
+// Its background jobs run on the pool of the server, not on threads of its own
+struct CalculatorServer::Session
+{
+    std::istringstream input;
+    std::ostringstream output;
+    FunctionCalculator calculator;
+
+    explicit Session(const CalculatorServer& server) : calculator(input, output)
+    {
+        calculator.setInteractive(false);
+        // 'undo' is refused by the server, so the session keeps no history
+        calculator.setUndoEnabled(false);
+        calculator.setMaxMatrixSize(server.m_maxMatrixSize);
+        calculator.setThreadPool(server.m_pool);
+    }
+};
+
+
+CalculatorServer::CalculatorServer(int maxFunctions, int maxMatrixSize)
+    : m_maxMatrixSize(maxMatrixSize)
+{
+    auto calculator = FunctionCalculator(std::cin, std::cout);
+    calculator.setMaxFunctions(maxFunctions);
+    m_state = std::make_shared<const FunctionCalculator::Snapshot>(calculator.snapshot());
+}
+
+std::string CalculatorServer::latencyReport() const
+{
+    const auto micros = [](std::chrono::nanoseconds latency)
+    {
+        return std::chrono::duration<double, std::micro>(latency).count();
+    };
+
+    auto report = std::ostringstream();
+    report << "reads: " << m_readLatency.count() << " requests, p50 " << micros(m_readLatency.percentile(0.5))
+        << " us, p99 " << micros(m_readLatency.percentile(0.99)) << " us\n"
+        << "writes: " << m_writeLatency.count() << " requests, p50 " << micros(m_writeLatency.percentile(0.5))
+        << " us, p99 " << micros(m_writeLatency.percentile(0.99)) << " us\n";
+    return report.str();
+}
+
+CalculatorServer::Response CalculatorServer::handle(Session& session, std::string_view line)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto args = Tokenizer(line);
+    const auto command = args.next();
+
+    if (command == "latency")
+        return { true, latencyReport() };
+    if (command == "shutdown")
+    {
+        stop();
+        return { true, "Server stopping.\n", true };
+    }
+    // A session's history would restore registries that other clients have changed since
+    if (command == "undo")
+        return { false, "Error: undo is not available on a shared function list.\n" };
+
+    if (!FunctionCalculator::mutatesRegistry(command).value_or(false))
+    {
+        session.calculator.restore(*m_state.load());
+        auto response = execute(session, line);
+        m_readLatency.record(std::chrono::steady_clock::now() - start);
+        return response;
+    }
+
+    auto lock = std::lock_guard(m_writer);
+    const auto current = m_state.load();
+    session.calculator.restore(*current);
+    auto response = execute(session, line);
+
+    const auto state = session.calculator.snapshot();
+    if (!state.operations.sharesStateWith(current->operations) || state.maxFunctions != current->maxFunctions)
+        m_state = std::make_shared<const FunctionCalculator::Snapshot>(state);
+    m_writeLatency.record(std::chrono::steady_clock::now() - start);
+    return response;
+}
+
+CalculatorServer::Response CalculatorServer::execute(Session& session, std::string_view line)
+{
+    session.output.str({});
+    auto ok = true;
+    try {
+        if (auto result = session.calculator.executeSingleCommand(line); !result)
+        {
+            session.output << "Error: " << result.error() << '\n';
+            ok = false;
+        }
+    }
+    catch (const std::exception& e) {
+        session.output << "Error: " << e.what() << '\n';
+        ok = false;
+    }
+    return { ok, session.output.str(), !session.calculator.isRunning() };
+}
+
+std::string CalculatorServer::frame(const Response& response)
+{
+    return (response.ok ? "ok " : "err ") + std::to_string(response.output.size()) + '\n' + response.output;
+}
+
+void CalculatorServer::serveStream(std::istream& istr, std::ostream& ostr)
+{
+    auto session = Session(*this);
+    std::string line;
+    while (!m_stopping && std::getline(istr, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (Tokenizer(line).atEnd())
+            continue;
+
+        const auto response = handle(session, line);
+        ostr << frame(response) << std::flush;
+        if (response.close)
+            break;
+    }
+}
+
+void CalculatorServer::stop()
+{
+    m_stopping = true;
+#ifndef _WIN32
+    // Wakes the accept() of serveSocket
+    if (const int listener = m_listener; listener >= 0)
+        shutdown(listener, SHUT_RDWR);
+    // and the recv() of every client, idle ones included, which still get their replies
+    auto lock = std::lock_guard(m_clientsMutex);
+    for (const int client : m_clients)
+        shutdown(client, SHUT_RD);
+#endif
+}
+
+#ifdef _WIN32
+
+void CalculatorServer::serveSocket(const std::string&)
+{
+    throw std::invalid_argument("Unix domain sockets are not supported on this platform.");
+}
+
+void CalculatorServer::serveClient(int)
+{
+}
+
+#else
+
+void CalculatorServer::serveSocket(const std::string& path)
+{
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Socket path is too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        throw std::invalid_argument("Failed to create socket: " + std::string(std::strerror(errno)));
+
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        const auto error = std::string(std::strerror(errno));
+        close(listener);
+        throw std::invalid_argument("Failed to listen on " + path + ": " + error);
+    }
+    m_listener = listener;
+
+    while (!m_stopping)
+    {
+        const int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        {
+            // A client accepted while stopping is not in the set stop() walked
+            auto lock = std::lock_guard(m_clientsMutex);
+            m_clients.insert(client);
+            if (m_stopping)
+                shutdown(client, SHUT_RD);
+        }
+        std::thread([this, client]
+            {
+                serveClient(client);
+                // Removed before closing, so stop() never shuts down a reused descriptor
+                auto lock = std::lock_guard(m_clientsMutex);
+                m_clients.erase(client);
+                close(client);
+                m_clientsDone.notify_all();
+            }).detach();
+    }
+
+    m_listener = -1;
+    close(listener);
+    unlink(path.c_str());
+
+    auto lock = std::unique_lock(m_clientsMutex);
+    m_clientsDone.wait(lock, [this] { return m_clients.empty(); });
+}
+
+void CalculatorServer::serveClient(int socket)
+{
+    auto session = Session(*this);
+    auto pending = std::string();
+    char buffer[4096];
+
+    while (true)
+    {
+        const auto received = recv(socket, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return;
+        pending.append(buffer, static_cast<std::size_t>(received));
+
+        // Answers every complete line, a partial last line waits for the next recv
+        std::size_t consumed = 0;
+        while (const auto* end = static_cast<const char*>(std::memchr(pending.data() + consumed, '\n', pending.size() - consumed)))
+        {
+            auto line = std::string_view(pending).substr(consumed, static_cast<std::size_t>(end - pending.data()) - consumed);
+            consumed += line.size() + 1;
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (Tokenizer(line).atEnd())
+                continue;
+
+            const auto response = handle(session, line);
+            const auto reply = frame(response);
+            for (std::size_t sent = 0; sent < reply.size();)
+            {
+                const auto written = send(socket, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    return;
+                sent += static_cast<std::size_t>(written);
+            }
+            if (response.close)
+                return;
+        }
+        pending.erase(0, consumed);
+    }
+}
+
+#endif
@@ -3,19 +3,24 @@
 #include <iostream>
 
 
-int Comp::inputCount() const
+Comp::Comp(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2)
+    : BinaryOperation(OperationKind::Comp, arg1, arg2)
 {
-    return first()->inputCount() + second()->inputCount() - 1;
+    cacheRendering();
 }
 
 
-Operation::T Comp::compute(const std::vector<T>& input) const
+Operation::Result Comp::tryCompute(std::span<const T> input) const
 {
-    const auto resultOfFirst = first()->compute(input);
-    auto firstCount = first()->inputCount();
-    std::vector input2(input.begin() + firstCount, input.end());
-	input2.insert(input2.begin(), resultOfFirst);
-    return second()->compute(input2);
+    auto resultOfFirst = first()->evaluate(input);
+    if (!resultOfFirst)
+        return resultOfFirst;
+    const auto firstCount = static_cast<std::size_t>(first()->inputCount());
+    auto input2 = std::vector<T>();
+    input2.reserve(input.size() - firstCount + 1);
+    input2.push_back(std::move(*resultOfFirst));
+    input2.insert(input2.end(), input.begin() + static_cast<std::ptrdiff_t>(firstCount), input.end());
+    return second()->evaluate(input2);
 }
 
 
@@ -0,0 +1,76 @@
+#include "DagPrinter.h"
+#include "Operation.h"
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+
+void DagPrinter::print(std::ostream& ostr, const Operation& root)
+{
+    // Count the references to every distinct node, recording them children first
+    // The walk keeps its own stack, so the depth of the DAG is not limited by the call stack
+    auto references = std::unordered_map<const Operation*, int>();
+    auto order = std::vector<const Operation*>();
+    auto stack = std::vector<std::pair<const Operation*, std::size_t>>{ { &root, 0 } };
+    while (!stack.empty())
+    {
+        auto& [node, next] = stack.back();
+        const auto children = node->children();
+        if (next < children.size())
+        {
+            const auto* child = children[next++].get();
+            if (++references[child] == 1)
+                stack.emplace_back(child, 0);
+            continue;
+        }
+        order.push_back(node);
+        stack.pop_back();
+    }
+
+    // Shared nodes are bound, and so is every node whose inline form would nest
+    // deeper than MAX_INLINE_DEPTH, which bounds the recursion of printBody
+    auto bindings = std::unordered_map<const Operation*, int>();
+    auto depths = std::unordered_map<const Operation*, int>();
+    for (const auto* node : order)
+    {
+        auto depth = 0;
+        for (const auto& child : node->children())
+            if (!bindings.contains(child.get()))
+                depth = std::max(depth, depths[child.get()] + 1);
+
+        if (node != &root && !node->children().empty() && (references[node] > 1 || depth >= MAX_INLINE_DEPTH))
+        {
+            bindings.emplace(node, static_cast<int>(bindings.size()) + 1);
+            depth = 0;
+        }
+        depths[node] = depth;
+    }
+
+    const std::function<void(std::ostream&, const Operation&, bool)> printBody =
+        [&](std::ostream& out, const Operation& node, bool first_print)
+    {
+        node.printNode(out, first_print, [&](std::ostream& childOut, std::size_t index)
+            {
+                const auto& child = *node.children()[index];
+                if (const auto it = bindings.find(&child); it != bindings.end())
+                    childOut << 'f' << it->second;
+                else
+                    printBody(childOut, child, false);
+            });
+    };
+
+    for (const auto* node : order)
+    {
+        if (const auto it = bindings.find(node); it != bindings.end())
+        {
+            ostr << "let f" << it->second << " = ";
+            printBody(ostr, *node, true);
+            ostr << "; ";
+        }
+    }
+    printBody(ostr, root, true);
+}
@@ -7,14 +7,76 @@
 #include "Transpose.h"
 #include "Scalar.h"
 #include "ReadCommand.h"
+#include "DagPrinter.h"
+#include "ScriptEngine.h"
+#include "MappedFile.h"
+#include "SnapshotFile.h"
 
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <sstream>
+#include <array>
+#include <limits>
+#include <chrono>
+#include <cstdint>
+
+namespace
+{
+    // Slots in the perfect hash table of command names
+    constexpr std::size_t COMMAND_TABLE_SIZE = 64;
+
+    // FNV-1a with the seed mixed into the offset basis
+    constexpr std::size_t commandHash(std::string_view command, std::size_t seed)
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+        for (const char c : command)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        hash ^= hash >> 32;
+        return static_cast<std::size_t>(hash % COMMAND_TABLE_SIZE);
+    }
+}
+
+constexpr auto FunctionCalculator::actionTable()
+{
+    return std::to_array<ActionDetails>({
+        {"eval", "(uate) num n - compute the result of function #num on an n׳n matrix", Action::Eval, 2, ANY_ARGS, false},
+        {"async", " num n - evaluate like eval as a background job", Action::Async, 2, ANY_ARGS, false},
+        {"jobs", " - list the background jobs not waited for or cancelled yet", Action::Jobs, 0, 0, false},
+        {"wait", " job - wait for a background job, print its result and remove it from the list", Action::Wait, 1, 1, false},
+        {"cancel", " job - stop a background job at its next operation, or discard its result, and remove it from the list", Action::Cancel, 1, 1, false},
+        {"stats", " [num|reset] - print the evaluation counters, per node of operation #num, or reset them", Action::Stats, 0, 1, false},
+        {"trace", " file_path num n - evaluate like eval and write a Chrome trace of the node evaluations", Action::Trace, 3, ANY_ARGS, false},
+        {"jit", " num n - compile operation #num to native code, used by later evals and asyncs on n׳n matrices", Action::Jit, 2, 2, false},
+        {"scal", "(ar) val - scalar multiplication", Action::Scal, 1, 1, true},
+        {"add",  " num1 num2 - add two operations", Action::Add, 2, 2, true},
+        {"sub",  " num1 num2 - subtract two operations", Action::Sub, 2, 2, true},
+        {"comp", "(osite) num1 num2 - compose two operations", Action::Comp, 2, 2, true},
+        {"read", " file_path - execute commands from file", Action::Read, 1, 1, true},
+        {"del",  "(ete) num - delete operation #num", Action::Del, 1, 1, true},
+        {"name", " num label - give operation #num a name usable in place of its number", Action::Name, 2, 2, true},
+        {"list", " [page] - list the operations, one page at a time", Action::List, 0, 1, false},
+        {"describe", " num [n] - show the structure of operation #num and its cost on n׳n matrices", Action::Describe, 1, 2, false},
+        {"view", " tree|dag - list operations as trees, or with shared parts written once", Action::View, 1, 1, false},
+        {"save", " file_path - write the function list to a binary snapshot file", Action::Save, 1, 1, false},
+        {"load", " file_path - replace the function list with one written by 'save'", Action::Load, 1, 1, true},
+        {"help", " - print command list", Action::Help, 0, 0, false},
+        {"undo", " - revert the last change to the function list", Action::Undo, 0, 0, true},
+        {"exit", " - exit program", Action::Exit, 0, 0, false},
+        { "resize", " n – change the maximum number of stored functions (2‑10000000)", Action::Resize, 1, 1, true },
+    });
+}
+
+std::optional<bool> FunctionCalculator::mutatesRegistry(std::string_view command)
+{
+    const auto* details = findAction(command);
+    if (!details)
+        return {};
+    return details->mutates;
+}
 
 FunctionCalculator::FunctionCalculator(std::istream& istr, std::ostream& ostr)
-    : m_actions(createActions()), m_operations(createOperations()), m_istr(istr), m_ostr(ostr)
+    : m_operations(createOperations()), m_istr(istr), m_ostr(ostr)
 {
 }
 
@@ -33,8 +95,8 @@ void FunctionCalculator::run()
             break;
 
         try {
-            executeSingleCommand(line);
-         
+            if (auto result = executeSingleCommand(line); !result)
+                m_ostr << "Error: " << result.error() << "\n";
         }
         catch (const std::invalid_argument& e) {
             m_ostr << "Error: " << e.what() << "\n";
@@ -48,12 +110,12 @@ void FunctionCalculator::askMaxFunctions()
 {
     int n;
     do {
-        m_ostr << "Enter max number of functions (2 - 100): ";
+        m_ostr << "Enter max number of functions (2 - " << MAX_FUNCTIONS_LIMIT << "): ";
         m_istr >> n;
 
-        if (!m_istr || n < 2 || n > 100)
+        if (!m_istr || n < 2 || n > MAX_FUNCTIONS_LIMIT)
         {
-            m_ostr << "Invalid input. Please enter a number between 2 and 100.\n";
+            m_ostr << "Invalid input. Please enter a number between 2 and " << MAX_FUNCTIONS_LIMIT << ".\n";
             m_istr.clear();
             m_istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         }
@@ -65,168 +127,574 @@ void FunctionCalculator::askMaxFunctions()
     } while (true);
 }
 
-void FunctionCalculator::eval()
+void FunctionCalculator::setMaxFunctions(int maxFunctions)
+{
+    if (maxFunctions < 2 || maxFunctions > MAX_FUNCTIONS_LIMIT)
+        throw std::invalid_argument("Max functions must be between 2 and " + std::to_string(MAX_FUNCTIONS_LIMIT));
+    if (static_cast<std::size_t>(maxFunctions) < m_operations.size())
+        throw std::invalid_argument("Max functions is smaller than the number of stored functions.");
+    m_maxFunctions = maxFunctions;
+}
+
+void FunctionCalculator::setMaxMatrixSize(int maxMatrixSize)
+{
+    if (maxMatrixSize < 2 || maxMatrixSize > MAX_MAT_SIZE_LIMIT)
+        throw std::invalid_argument("Max matrix size must be between 2 and " + std::to_string(MAX_MAT_SIZE_LIMIT));
+    m_maxMatrixSize = maxMatrixSize;
+}
+
+int FunctionCalculator::readMatrixSize(Tokenizer& args) const
+{
+    const auto size = args.nextInt();
+    if (!size)
+        throw std::invalid_argument("Expected matrix size.");
+    if (*size <= 1 || *size > m_maxMatrixSize)
+        throw std::invalid_argument("Matrix size must be between 2 and " + std::to_string(m_maxMatrixSize));
+    return *size;
+}
+
+std::expected<std::vector<Operation::T>, MatrixError> FunctionCalculator::readInputs(Tokenizer& args,
+    const Operation& operation)
+{
+    int inputCount = operation.inputCount();
+    if (inputCount < 1 || inputCount == MAX_INPUT_COUNT)
+        throw std::invalid_argument("Operation takes an invalid number of input matrices.");
+    const int size = readMatrixSize(args);
+
+#ifdef FC_ENABLE_PROFILING
+    const auto timer = profiling::ScopedTimer(profiling::globalCounters().parseNanoseconds);
+    profiling::globalCounters().parsedMatrices.fetch_add(static_cast<std::uint64_t>(inputCount));
+#endif
+    auto matrixVec = std::vector<Operation::T>();
+    if (inputCount > 1 && m_interactive)
+        m_ostr << "\nPlease enter " << inputCount << " matrices:\n";
+
+    for (int i = 0; i < inputCount; ++i)
+    {
+        auto input = Operation::T(size);
+        if (m_interactive)
+            m_ostr << "\nEnter a " << size << "x" << size << " matrix:\n";
+        if (auto read = tryParseMatrix([&args] { return args.nextInt(); }, input); !read)
+            return std::unexpected(read.error());
+        matrixVec.push_back(std::move(input));
+    }
+    return matrixVec;
+}
+
+void FunctionCalculator::printResult(const Operation& operation, const std::vector<Operation::T>& inputs,
+    const Operation::T& result) const
+{
+#ifdef FC_ENABLE_PROFILING
+    const auto timer = profiling::ScopedTimer(profiling::globalCounters().formatNanoseconds);
+    profiling::globalCounters().formattedResults.fetch_add(1);
+#endif
+    m_ostr << "\n";
+    if (operation.isRenderingCached())
+        operation.print(m_ostr, inputs);
+    else
+    {
+        printOperation(operation);
+        for (const auto& input : inputs)
+            m_ostr << "(\n" << input << ")";
+    }
+    m_ostr << " = \n" << result;
+}
+
+void FunctionCalculator::printOperation(const Operation& operation) const
+{
+    // Operations too large to have a cached tree form are always printed as a DAG
+    if (m_dagView || !operation.isRenderingCached())
+        DagPrinter::print(m_ostr, operation);
+    else
+        operation.print(m_ostr, true);
+}
+
+FunctionCalculator::CommandResult FunctionCalculator::eval(Tokenizer& args)
 {
     ensureSpace();
 
-    if (auto index = readOperationIndex(); index)
+    if (const auto operation = readOperation(args); operation)
+    {
+        const auto inputs = readInputs(args, *operation);
+        if (!inputs)
+            return std::unexpected(inputs.error());
+
+        const auto result = m_jit.evaluate(*operation, *inputs);
+        if (!result)
+            return std::unexpected(result.error());
+        printResult(*operation, *inputs, *result);
+    }
+    return {};
+}
+
+FunctionCalculator::CommandResult FunctionCalculator::async(Tokenizer& args)
+{
+    const auto operation = readOperation(args);
+    if (!operation)
+        return {};
+
+    auto inputs = readInputs(args, *operation);
+    if (!inputs)
+        return std::unexpected(inputs.error());
+
+    if (m_jobs.jobs().size() >= JobManager::MAX_JOBS)
+        throw std::invalid_argument("Too many jobs (max: " + std::to_string(JobManager::MAX_JOBS)
+            + "), wait for or cancel some first.");
+
+    // The kernel is looked up here, the compiler itself is not shared with the workers
+    auto kernel = m_jit.kernelFor(*operation, inputs->front().size());
+    const auto id = m_jobs.submit(operation, std::move(*inputs), std::move(kernel));
+    m_ostr << "Job #" << id << " started.\n";
+    return {};
+}
+
+void FunctionCalculator::jobs() const
+{
+    if (m_jobs.jobs().empty())
+        m_ostr << "No jobs.\n";
+
+    for (const auto& [id, job] : m_jobs.jobs())
+    {
+        const auto status = job->status();
+        m_ostr << '#' << id << " [" << statusName(status);
+        if (status != JobManager::Status::Running)
+            m_ostr << " in " << job->seconds() * 1000 << " ms";
+        m_ostr << "] ";
+        printOperation(job->operation());
+        m_ostr << " on " << job->inputs().size() << (job->inputs().size() == 1 ? " matrix\n" : " matrices\n");
+    }
+}
+
+std::shared_ptr<JobManager::Job> FunctionCalculator::readJob(Tokenizer& args) const
+{
+    const auto token = args.next();
+    const auto id = Tokenizer(token).nextInt();
+    auto job = id && *id > 0 ? m_jobs.find(static_cast<std::size_t>(*id)) : nullptr;
+    if (job)
+        return job;
+    if (id && *id > 0 && m_jobs.wasIssued(static_cast<std::size_t>(*id)))
+        throw std::invalid_argument("Job #" + std::string(token) + " was already waited for or cancelled");
+    throw std::invalid_argument("Job #" + std::string(token) + " doesn't exist");
+}
+
+FunctionCalculator::CommandResult FunctionCalculator::wait(Tokenizer& args)
+{
+    const auto job = readJob(args);
+    m_ostr.flush();
+    job->wait();
+    m_jobs.remove(job->id());
+
+    if (!job->failure().empty())
+        throw std::invalid_argument("Job #" + std::to_string(job->id()) + " failed: " + job->failure());
+    const auto& result = job->result();
+    if (!result)
+        return std::unexpected(result.error());
+    printResult(job->operation(), job->inputs(), *result);
+    return {};
+}
+
+void FunctionCalculator::cancel(Tokenizer& args)
+{
+    const auto job = readJob(args);
+    m_jobs.remove(job->id());
+    if (job->status() != JobManager::Status::Running)
     {
-        const auto& operation = m_operations[*index];
-        int inputCount = operation->inputCount();
-        int size = 0;
-        m_istr >> size;
+        m_ostr << "Job #" << job->id() << " result discarded.\n";
+        return;
+    }
+    job->cancel();
+    m_ostr << "Job #" << job->id() << " cancelling.\n";
+}
 
-        if (!m_istr)
-            throw std::invalid_argument("Expected matrix size.");
+void FunctionCalculator::jit(Tokenizer& args)
+{
+    const auto id = readOperationId(args);
+    if (!id)
+        return;
+    const auto size = readMatrixSize(args);
 
-        if (size <= 1 || size > MAX_MAT_SIZE)
-            throw std::invalid_argument("Matrix size must be between 2 and " + std::to_string(MAX_MAT_SIZE));
+    const auto compiled = m_jit.compile(m_operations.find(*id), size);
+    if (!compiled)
+    {
+        m_ostr << "Operation #" << *id << " was not compiled: " << compiled.error()
+            << ". Its evaluations keep using the interpreter.\n";
+        return;
+    }
+    m_ostr << "Operation #" << *id << " compiled for " << size << 'x' << size << " matrices"
+        << (compiled->cached ? " from the cache" : "") << " in " << compiled->seconds * 1000 << " ms.\n";
+}
 
-        auto matrixVec = std::vector<Operation::T>();
-        if (inputCount > 1)
-            m_ostr << "\nPlease enter " << inputCount << " matrices:\n";
+#ifdef FC_ENABLE_PROFILING
 
-        for (int i = 0; i < inputCount; ++i)
-        {
-            auto input = Operation::T(size);
-            m_ostr << "\nEnter a " << size << "x" << size << " matrix:\n";
-            m_istr >> input;
-            matrixVec.push_back(input);
-        }
+void FunctionCalculator::stats(Tokenizer& args)
+{
+    auto& counters = profiling::globalCounters();
+    const auto argument = args.next();
+    if (argument == "reset")
+    {
+        counters.reset();
+        m_operations.forEachInSlots(0, m_operations.slotCount(), [](FunctionId, const std::shared_ptr<Operation>& operation)
+            {
+                profiling::resetNodeStats(*operation);
+            });
+        m_ostr << "Counters reset.\n";
+        return;
+    }
 
-        m_ostr << "\n";
-        operation->print(m_ostr, matrixVec);
-        m_ostr << " = \n" << operation->compute(matrixVec);
+    if (!argument.empty())
+    {
+        auto idArgs = Tokenizer(argument);
+        if (const auto operation = readOperation(idArgs))
+            profiling::printNodeStats(m_ostr, *operation);
+        return;
     }
+
+    m_ostr << "render cache: " << counters.renderCacheHits << " hits, " << counters.renderCacheMisses << " misses\n"
+        << "parse: " << counters.parsedMatrices << " matrices in " << static_cast<double>(counters.parseNanoseconds) / 1e6 << " ms\n"
+        << "format: " << counters.formattedResults << " results in " << static_cast<double>(counters.formatNanoseconds) / 1e6 << " ms\n";
+    m_operations.forEachInSlots(0, m_operations.slotCount(), [this](FunctionId id, const std::shared_ptr<Operation>& operation)
+        {
+            const auto& node = operation->counters();
+            if (node.calls == 0)
+                return;
+            m_ostr << id << ". " << node.calls << " evaluations, " << static_cast<double>(node.nanoseconds) / 1e6 << " ms, "
+                << node.bytesAllocated << " bytes allocated, " << node.matricesCopied << " matrices copied\n";
+        });
 }
 
-void FunctionCalculator::del()
+FunctionCalculator::CommandResult FunctionCalculator::trace(Tokenizer& args)
 {
-    if (auto i = readOperationIndex(); i)
+    const auto path = std::string(args.next());
+    const auto operation = readOperation(args);
+    if (!operation)
+        return {};
+    const auto inputs = readInputs(args, *operation);
+    if (!inputs)
+        return std::unexpected(inputs.error());
+
+    auto recorder = profiling::TraceRecorder();
+    const auto result = operation->evaluate(*inputs);
+
+    auto file = std::ofstream(path);
+    recorder.writeChromeTrace(file);
+    if (!file.flush())
+        throw std::invalid_argument("Failed to write file: " + path);
+    m_ostr << "Trace of " << recorder.events().size() << " node evaluations written to " << path << ".\n";
+
+    if (!result)
+        return std::unexpected(result.error());
+    printResult(*operation, *inputs, *result);
+    return {};
+}
+
+#else
+
+void FunctionCalculator::stats(Tokenizer&)
+{
+    throw std::invalid_argument("Profiling is not compiled in, configure with -DENABLE_PROFILING=ON.");
+}
+
+FunctionCalculator::CommandResult FunctionCalculator::trace(Tokenizer&)
+{
+    throw std::invalid_argument("Profiling is not compiled in, configure with -DENABLE_PROFILING=ON.");
+}
+
+#endif
+
+void FunctionCalculator::del(Tokenizer& args)
+{
+    if (auto id = readOperationId(args); id)
     {
-        m_operations.erase(m_operations.begin() + *i);
+        m_operations.erase(*id);
     }
 }
 
+void FunctionCalculator::name(Tokenizer& args)
+{
+    const auto id = readOperationId(args);
+    const auto label = args.next();
+    if (!id)
+        throw std::invalid_argument("Invalid arguments: operation does not exist in the operation list.");
+    if (!m_operations.setName(*id, std::string(label)))
+        throw std::invalid_argument("Name '" + std::string(label) + "' must start with a letter and not be in use.");
+}
+
+void FunctionCalculator::list(Tokenizer& args)
+{
+    auto page = std::optional<int>(0);
+    if (!args.atEnd())
+        page = args.nextInt();
+    if (!page || *page < 0)
+        throw std::invalid_argument("Page must be a non-negative number.");
+    printOperations(static_cast<std::size_t>(*page));
+}
+
+void FunctionCalculator::describe(Tokenizer& args)
+{
+    const auto operation = readOperation(args);
+    if (!operation)
+        return;
+
+    auto size = std::optional<int>(MAX_MAT_SIZE);
+    if (!args.atEnd())
+        size = args.nextInt();
+    if (!size || *size < 1)
+        throw std::invalid_argument("Matrix size must be a positive number.");
+
+    const auto& info = operation->info();
+    const auto cost = info.estimate(*size);
+    m_ostr << "kind: " << kindName(info.kind)
+        << "\ninputs: " << info.inputCount
+        << "\ndepth: " << info.depth
+        << "\nnodes: " << info.nodeCount
+        << "\nhash: " << std::hex << info.hash << std::dec
+        << "\nestimated cost for " << *size << "x" << *size << " matrices: "
+        << cost.flops << " element operations, " << cost.bytes << " bytes\n";
+}
+
+void FunctionCalculator::save(Tokenizer& args) const
+{
+    const auto path = std::string(args.next());
+    SnapshotFile::save(path, snapshot());
+    m_ostr << "Saved " << m_operations.size() << " functions to " << path << ".\n";
+}
+
+void FunctionCalculator::load(Tokenizer& args)
+{
+    const auto path = std::string(args.next());
+    restore(SnapshotFile::load(path));
+    m_ostr << "Loaded " << m_operations.size() << " functions from " << path << ".\n";
+}
+
+void FunctionCalculator::view(Tokenizer& args)
+{
+    const auto mode = args.next();
+    if (mode != "tree" && mode != "dag")
+        throw std::invalid_argument("View must be 'tree' or 'dag'.");
+    m_dagView = mode == "dag";
+}
+
 void FunctionCalculator::help()
 {
     m_ostr << "The available commands are:\n";
-    for (const auto& action : m_actions)
+    for (const auto& action : actionTable())
         m_ostr << "* " << action.command << action.description << '\n';
     m_ostr << '\n';
 }
 
+void FunctionCalculator::setUndoEnabled(bool enabled)
+{
+    m_undoEnabled = enabled;
+    if (!enabled)
+        m_history.clear();
+}
+
+void FunctionCalculator::undo()
+{
+    if (!m_undoEnabled)
+        throw std::invalid_argument("Undo is not available.");
+    if (m_history.empty())
+        throw std::invalid_argument("Nothing to undo.");
+
+    restore(m_history.back());
+    m_history.pop_back();
+}
+
+FunctionCalculator::Snapshot FunctionCalculator::snapshot() const
+{
+    return { m_operations, m_maxFunctions };
+}
+
+void FunctionCalculator::restore(const Snapshot& state)
+{
+    m_operations = state.operations;
+    m_maxFunctions = state.maxFunctions;
+}
+
 void FunctionCalculator::exit()
 {
     m_ostr << "Goodbye!\n";
     m_running = false;
 }
 
-void FunctionCalculator::printOperations() const
+void FunctionCalculator::printOperations(std::size_t page) const
 {
     m_ostr << "List of available matrix operations (" << m_operations.size()
         << " / " << m_maxFunctions << " used):\n";
 
-    for (decltype(m_operations.size()) i = 0; i < m_operations.size(); ++i)
-    {
-        m_ostr << i << ". ";
-        m_operations[i]->print(m_ostr, true);
-        m_ostr << '\n';
-    }
+    m_operations.forEachLive(page * LIST_PAGE_SIZE, LIST_PAGE_SIZE, [this](FunctionId id, const std::shared_ptr<Operation>& operation)
+        {
+            m_ostr << id;
+            if (const auto* label = m_operations.nameOf(id))
+                m_ostr << " [" << *label << ']';
+            m_ostr << ". ";
+            printOperation(*operation);
+            m_ostr << '\n';
+        });
+
+    if ((page + 1) * LIST_PAGE_SIZE < m_operations.size())
+        m_ostr << "... more functions, use 'list " << page + 1 << "' to see them\n";
     m_ostr << '\n';
 }
 
 void FunctionCalculator::ensureSpace() const
 {
-    if (m_operations.size() >= m_maxFunctions)
+    if (m_operations.size() >= static_cast<std::size_t>(m_maxFunctions))
         throw std::invalid_argument("Function list is full (max: " + std::to_string(m_maxFunctions) + ")");
 }
 
-std::optional<int> FunctionCalculator::readOperationIndex() const
+std::optional<FunctionId> FunctionCalculator::readOperationId(Tokenizer& args) const
 {
-    int i = 0;
-    m_istr >> i;
-    if (i >= static_cast<int>(m_operations.size()))
-    {
-        m_ostr << "Operation #" << i << " doesn't exist\n";
-        return {};
-    }
-    return i;
+    const auto token = args.next();
+    const auto id = m_operations.resolve(token);
+    if (!id)
+        m_ostr << "Operation #" << token << " doesn't exist\n";
+    return id;
 }
 
-FunctionCalculator::Action FunctionCalculator::readAction() const
+std::shared_ptr<Operation> FunctionCalculator::readOperation(Tokenizer& args) const
 {
-    std::string action;
-    m_istr >> action;
-
-    const auto i = std::ranges::find(m_actions, action, &ActionDetails::command);
-    return i != m_actions.end() ? i->action : Action::Invalid;
+    const auto id = readOperationId(args);
+    return id ? m_operations.find(*id) : nullptr;
 }
 
-void FunctionCalculator::runAction(Action action)
+FunctionCalculator::CommandResult FunctionCalculator::runAction(Action action, Tokenizer& args)
 {
     switch (action)
     {
-    case Action::Eval:         eval();                     break;
-    case Action::Add:          binaryFunc<Add>();          break;
-    case Action::Sub:          binaryFunc<Sub>();          break;
-    case Action::Comp:         binaryFunc<Comp>();         break;
-    case Action::Read:         ReadCommand::run(*this, m_istr); break;
-    case Action::Del:          del();                      break;
-    case Action::Help:         help();                     break;
-    case Action::Exit:         exit();                     break;
-    case Action::Scal:         unaryWithIntFunc<Scalar>(); break;
-    case Action::Resize:       resizeOperations();          break;
+    case Action::Eval:         return eval(args);
+    case Action::Async:        return async(args);
+    case Action::Wait:         return wait(args);
+    case Action::Jobs:         jobs();                         break;
+    case Action::Cancel:       cancel(args);                   break;
+    case Action::Stats:        stats(args);                    break;
+    case Action::Trace:        return trace(args);
+    case Action::Jit:          jit(args);                      break;
+    case Action::Add:          binaryFunc<Add>(args);          break;
+    case Action::Sub:          binaryFunc<Sub>(args);          break;
+    case Action::Comp:         binaryFunc<Comp>(args);         break;
+    case Action::Read:         ReadCommand::run(*this, args);  break;
+    case Action::Del:          del(args);                      break;
+    case Action::Help:         help();                         break;
+    case Action::Exit:         exit();                         break;
+    case Action::Scal:         unaryWithIntFunc<Scalar>(args); break;
+    case Action::Resize:       resizeOperations(args);         break;
+    case Action::Undo:         undo();                         break;
+    case Action::Name:         name(args);                     break;
+    case Action::List:         list(args);                     break;
+    case Action::View:         view(args);                     break;
+    case Action::Describe:     describe(args);                 break;
+    case Action::Save:         save(args);                     break;
+    case Action::Load:         load(args);                     break;
     default:
         throw std::invalid_argument("Command not found\n");
     }
+    return {};
 }
 
-FunctionCalculator::ActionMap FunctionCalculator::createActions() const
+const FunctionCalculator::ActionDetails* FunctionCalculator::findAction(std::string_view command)
 {
-    return {
-        {"eval", "(uate) num n - compute the result of function #num on an n׳n matrix", Action::Eval},
-        {"scal", "(ar) val - scalar multiplication", Action::Scal},
-        {"add",  " num1 num2 - add two operations", Action::Add},
-        {"sub",  " num1 num2 - subtract two operations", Action::Sub},
-        {"comp", "(osite) num1 num2 - compose two operations", Action::Comp},
-        {"read", " file_path - execute commands from file", Action::Read},
-        {"del",  "(ete) num - delete operation #num", Action::Del},
-        {"help", " - print command list", Action::Help},
-        {"exit", " - exit program", Action::Exit},
-        { "resize", " n – change the maximum number of stored functions (2‑100)", Action::Resize },
-    };
+    static constexpr auto table = actionTable();
+
+    // The first seed under which every command gets a slot of its own
+    static constexpr std::size_t seed = [] {
+        for (std::size_t candidate = 0;; ++candidate)
+        {
+            auto used = std::array<bool, COMMAND_TABLE_SIZE>();
+            bool collision = false;
+            for (const auto& details : table)
+            {
+                const auto slot = commandHash(details.command, candidate);
+                collision = collision || used[slot];
+                used[slot] = true;
+            }
+            if (!collision)
+                return candidate;
+        }
+    }();
+
+    static constexpr auto slots = [] {
+        auto result = std::array<int, COMMAND_TABLE_SIZE>();
+        result.fill(-1);
+        for (std::size_t i = 0; i < table.size(); ++i)
+            result[commandHash(table[i].command, seed)] = static_cast<int>(i);
+        return result;
+    }();
+
+    const int index = slots[commandHash(command, seed)];
+    if (index < 0 || table[static_cast<std::size_t>(index)].command != command)
+        return nullptr;
+    return &table[static_cast<std::size_t>(index)];
 }
 
 FunctionCalculator::OperationList FunctionCalculator::createOperations() const
 {
-    return {
-        std::make_shared<Identity>(),
-        std::make_shared<Transpose>(),
-    };
+    auto operations = OperationList();
+    operations.insert(std::make_shared<Identity>());
+    operations.insert(std::make_shared<Transpose>());
+    return operations;
 }
 
 void FunctionCalculator::executeFromFile(const std::string& filePath)
 {
-    std::ifstream file(filePath);
-    if (!file)
-        throw std::invalid_argument("Failed to open file: " + filePath);
+    const auto file = MappedFile(filePath);
 
-    std::string line;
-    int lineNumber = 0;
+    std::size_t commands = 0;
+    auto failure = std::optional<std::string>();
+    const auto start = std::chrono::steady_clock::now();
+    const auto initialState = snapshot();
+    ++m_fileDepth;
 
-    while (std::getline(file, line))
+    // Reports a failed line, returns false when reading the file stops
+    const auto reportError = [&](std::size_t lineNumber, const auto& error)
     {
-        ++lineNumber;
-        try {
-            executeSingleCommand(line);
-        }
-        catch (const std::exception& e)
+        if (!m_interactive)
         {
-            m_ostr << "Error (in file, line " << lineNumber << "): " << e.what() << "\n";
-            if (!askUserToContinue()) break;
+            auto message = std::ostringstream();
+            message << "In file " << filePath << ", line " << lineNumber << ": " << error;
+            failure = message.str();
+            return false;
         }
-    }
+
+        m_ostr << "Error (in file, line " << lineNumber << "): " << error << "\n";
+        if (askUserToContinue())
+            return true;
+
+        restore(initialState);
+        m_ostr << "Changes made by the file were rolled back.\n";
+        return false;
+    };
+
+    ScriptEngine::forEachLine(file.contents(), [&](std::string_view line, std::size_t lineNumber)
+        {
+            if (Tokenizer(line).atEnd())
+                return true;
+
+            ++commands;
+            try {
+                if (auto result = executeSingleCommand(line); !result)
+                    return reportError(lineNumber, result.error());
+            }
+            catch (const std::exception& e)
+            {
+                return reportError(lineNumber, e.what());
+            }
+            return m_running;
+        });
+    --m_fileDepth;
+
+    // Without a user to ask, the whole 'read' fails and its command rolls the file back
+    if (failure)
+        throw std::invalid_argument(*failure);
+    // The throughput is for script runs, the REPL keeps its usual output
+    if (m_interactive)
+        return;
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_ostr << "Executed " << commands << " commands from file in " << elapsed * 1000 << " ms";
+    if (elapsed > 0)
+        m_ostr << " (" << static_cast<long long>(static_cast<double>(commands) / elapsed) << " commands/s)";
+    m_ostr << "\n";
 }
 
 bool FunctionCalculator::askUserToContinue()
@@ -299,61 +767,48 @@ bool FunctionCalculator::askUserToContinue()
 //    this->m_operations = temp.m_operations;
 //}
 
-void FunctionCalculator::executeSingleCommand(const std::string& line)
+FunctionCalculator::CommandResult FunctionCalculator::executeSingleCommand(std::string_view line)
 {
-    std::istringstream lineStream(line);
-    std::string command;
-    lineStream >> command;
+    auto args = Tokenizer(line);
+    const auto command = args.next();
 
-    const auto it = std::ranges::find(m_actions, command, &ActionDetails::command);
-    if (it == m_actions.end())
+    const auto* details = findAction(command);
+    if (!details)
         throw std::invalid_argument("Command not found");
 
-    std::vector<std::string> tokens;
-    std::string token;
-    while (lineStream >> token)
-        tokens.push_back(token);
-
     // Argument validation
-    switch (it->action)
+    const auto count = static_cast<int>(args.remaining());
+    if (count < details->minArgs || (details->maxArgs != ANY_ARGS && count > details->maxArgs))
     {
-    case Action::Add:
-    case Action::Sub:
-    case Action::Comp:
-        if (tokens.size() != 2)
-            throw std::invalid_argument("Command '" + command + "' expects exactly 2 arguments.");
-        break;
-    case Action::Scal:
-    case Action::Del:
-    case Action::Read:
-    case Action::Resize:
-        if (tokens.size() != 1)
-            throw std::invalid_argument("Command '" + command + "' expects exactly 1 argument.");
-        break;
-    case Action::Help:
-    case Action::Exit:
-        if (!tokens.empty())
-            throw std::invalid_argument("Command '" + command + "' does not take any arguments.");
-        break;
-    default:
-        break;
+        if (details->maxArgs == 0)
+            throw std::invalid_argument("Command '" + std::string(command) + "' does not take any arguments.");
+        if (details->minArgs == details->maxArgs)
+            throw std::invalid_argument("Command '" + std::string(command) + "' expects exactly "
+                + std::to_string(details->minArgs) + (details->minArgs == 1 ? " argument." : " arguments."));
+        throw std::invalid_argument("Command '" + std::string(command) + "' expects at least "
+            + std::to_string(details->minArgs) + " arguments.");
     }
 
-    std::ostringstream cleaned;
-    for (const auto& s : tokens)
-        cleaned << s << ' ';
-    std::istringstream argsStream(cleaned.str());
-
-    // פעולות רגילות
-    FunctionCalculator temp(argsStream, m_ostr);
-    temp.m_operations = this->m_operations;
-    temp.m_actions = this->m_actions;
-    temp.m_maxFunctions = this->m_maxFunctions;
-
-    temp.runAction(it->action);
-    this->m_operations = temp.m_operations;
-    this->m_maxFunctions = temp.m_maxFunctions;
+    // Commands are all-or-nothing: the O(1) snapshot restores the function list if one throws
+    const auto before = snapshot();
+    auto result = CommandResult();
+    try {
+        result = runAction(details->action, args);
+    }
+    catch (...) {
+        restore(before);
+        throw;
+    }
 
+    // Commands run from a file are undone together with their 'read'
+    const bool changed = !m_operations.sharesStateWith(before.operations) || m_maxFunctions != before.maxFunctions;
+    if (changed && m_undoEnabled && details->action != Action::Undo && m_fileDepth == 0)
+    {
+        if (m_history.size() == MAX_UNDO_STEPS)
+            m_history.pop_front();
+        m_history.push_back(before);
+    }
+    return result;
 }
 
 
@@ -390,31 +845,36 @@ void FunctionCalculator::executeSingleCommand(const std::string& line)
 //    m_ostr << "Max functions set to " << m_maxFunctions << ".\n";
 //}
 
-void FunctionCalculator::resizeOperations()
+void FunctionCalculator::resizeOperations(Tokenizer& args)
 {
-    size_t newSize;
-    m_istr >> newSize;
+    const auto value = args.nextInt();
+
+    if (!value || *value < 2 || *value > MAX_FUNCTIONS_LIMIT)
+        throw std::invalid_argument("Resize value must be between 2 and " + std::to_string(MAX_FUNCTIONS_LIMIT));
 
-    if (newSize < 2 || newSize > 100)
-        throw std::invalid_argument("Resize value must be between 2 and 100");
+    const auto newSize = static_cast<std::size_t>(*value);
 
     if (newSize < m_operations.size())
     {
         m_ostr << "Warning: currently " << m_operations.size()
             << " operations stored. Resizing to " << newSize
-            << " will delete operations [" << newSize << " .. " << m_operations.size() - 1 << "].\n";
+            << " will delete the " << m_operations.size() - newSize << " operations with the highest numbers.\n";
 
-        m_ostr << "Continue? (y/n): ";
-        std::string choice;
-        std::cin >> choice;
+        // A script asked for the resize explicitly, there is no one to confirm it
+        if (m_interactive)
+        {
+            m_ostr << "Continue? (y/n): ";
+            std::string choice;
+            std::cin >> choice;
 
-        if (choice != "y" && choice != "Y")
-            throw std::invalid_argument("Resize aborted by user.");
+            if (choice != "y" && choice != "Y")
+                throw std::invalid_argument("Resize aborted by user.");
+        }
 
         // מחיקת הפקודות המיותרות
-        m_operations.erase(m_operations.begin() + newSize, m_operations.end());
+        m_operations.shrinkTo(newSize);
     }
 
-    m_maxFunctions = newSize;
+    m_maxFunctions = *value;
     m_ostr << "Max functions set to " << m_maxFunctions << ".\n";
 }
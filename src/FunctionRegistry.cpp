@@ -0,0 +1,176 @@
+#include "FunctionRegistry.h"
+#include "Tokenizer.h"
+
+#include <iostream>
+#include <cctype>
+
+
+std::ostream& operator<<(std::ostream& ostr, const FunctionId& id)
+{
+    ostr << id.index;
+    if (id.generation > 0)
+        ostr << '.' << id.generation;
+    return ostr;
+}
+
+
+std::optional<FunctionRegistry> FunctionRegistry::fromSlots(const std::vector<SlotRecord>& slots)
+{
+    auto registry = FunctionRegistry();
+    auto built = std::vector<Slot>(slots.size());
+
+    // Walks down so the free list is chained lowest index first
+    for (auto i = slots.size(); i > 0; --i)
+    {
+        const auto index = static_cast<std::uint32_t>(i - 1);
+        const auto& record = slots[index];
+        auto& slot = built[index];
+        slot.generation = record.generation;
+        if (!record.operation)
+        {
+            slot.nextFree = registry.m_freeHead;
+            registry.m_freeHead = index;
+            continue;
+        }
+
+        slot.operation = record.operation;
+        ++registry.m_count;
+        if (!record.name.empty())
+        {
+            if (!std::isalpha(static_cast<unsigned char>(record.name.front())) || registry.m_names.find(record.name))
+                return {};
+            registry.m_names.set(record.name, FunctionId{ index, record.generation });
+            slot.name = std::make_shared<const std::string>(record.name);
+        }
+    }
+
+    registry.m_slots = PersistentVector<Slot>(built);
+    return registry;
+}
+
+
+FunctionRegistry::SlotRecord FunctionRegistry::slotRecord(std::size_t index) const
+{
+    const auto& slot = m_slots[index];
+    return { slot.operation, slot.generation, slot.name ? *slot.name : std::string() };
+}
+
+
+FunctionId FunctionRegistry::insert(std::shared_ptr<Operation> operation)
+{
+    ++m_count;
+    if (m_freeHead == NO_SLOT)
+    {
+        auto slot = Slot();
+        slot.operation = std::move(operation);
+        m_slots.push_back(slot);
+        return FunctionId{ static_cast<std::uint32_t>(m_slots.size() - 1), 0 };
+    }
+
+    const auto index = m_freeHead;
+    auto slot = m_slots[index];
+    m_freeHead = slot.nextFree;
+    slot.operation = std::move(operation);
+    slot.nextFree = NO_SLOT;
+    m_slots.set(index, slot);
+    return FunctionId{ index, slot.generation };
+}
+
+
+bool FunctionRegistry::erase(FunctionId id)
+{
+    const auto* found = slotOf(id);
+    if (!found)
+        return false;
+
+    auto slot = *found;
+    if (slot.name)
+        m_names.erase(*slot.name);
+    slot.operation = nullptr;
+    slot.name = nullptr;
+    ++slot.generation;
+    slot.nextFree = m_freeHead;
+    m_slots.set(id.index, slot);
+    m_freeHead = id.index;
+    --m_count;
+    return true;
+}
+
+
+void FunctionRegistry::shrinkTo(std::size_t newSize)
+{
+    for (auto i = m_slots.size(); i > 0 && m_count > newSize; --i)
+    {
+        const auto index = static_cast<std::uint32_t>(i - 1);
+        erase(FunctionId{ index, m_slots[index].generation });
+    }
+}
+
+
+std::shared_ptr<Operation> FunctionRegistry::find(FunctionId id) const
+{
+    const auto* slot = slotOf(id);
+    return slot ? slot->operation : nullptr;
+}
+
+
+std::optional<FunctionId> FunctionRegistry::resolve(std::string_view token) const
+{
+    if (token.empty())
+        return {};
+
+    if (!std::isdigit(static_cast<unsigned char>(token.front())))
+    {
+        const auto* id = m_names.find(std::string(token));
+        if (!id)
+            return {};
+        return *id;
+    }
+
+    const auto dot = token.find('.');
+    const auto index = Tokenizer(token.substr(0, dot)).nextInt();
+    const auto generation = dot == std::string_view::npos ? std::optional<int>(0) : Tokenizer(token.substr(dot + 1)).nextInt();
+    if (!index || !generation || *index < 0 || *generation < 0)
+        return {};
+
+    const auto id = FunctionId{ static_cast<std::uint32_t>(*index), static_cast<std::uint32_t>(*generation) };
+    if (!slotOf(id))
+        return {};
+    return id;
+}
+
+
+bool FunctionRegistry::setName(FunctionId id, const std::string& name)
+{
+    const auto* found = slotOf(id);
+    if (!found || name.empty() || !std::isalpha(static_cast<unsigned char>(name.front())))
+        return false;
+    if (const auto* named = m_names.find(name); named && *named != id)
+        return false;
+
+    auto slot = *found;
+    if (slot.name)
+        m_names.erase(*slot.name);
+    m_names.set(name, id);
+
+    slot.name = std::make_shared<const std::string>(name);
+    m_slots.set(id.index, slot);
+    return true;
+}
+
+
+const std::string* FunctionRegistry::nameOf(FunctionId id) const
+{
+    const auto* slot = slotOf(id);
+    return slot && slot->name ? slot->name.get() : nullptr;
+}
+
+
+const FunctionRegistry::Slot* FunctionRegistry::slotOf(FunctionId id) const
+{
+    if (id.index >= m_slots.size())
+        return nullptr;
+    const auto& slot = m_slots[id.index];
+    return slot.operation && slot.generation == id.generation ? &slot : nullptr;
+}
+
@@ -3,7 +3,13 @@
 #include <iostream>
 
 
-Operation::T Identity::compute(const std::vector<T>& input) const
+Identity::Identity()
+    : UnaryOperation(OperationKind::Identity)
+{
+}
+
+
+Operation::Result Identity::tryCompute(std::span<const T> input) const
 {
     return input.front();
 }
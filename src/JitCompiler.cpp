@@ -0,0 +1,390 @@
+#include "JitCompiler.h"
+#include "Scalar.h"
+
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <system_error>
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+
+namespace
+{
+    // Part of the cached file names, so objects of an older generator are never loaded
+    constexpr int GENERATOR_VERSION = 2;
+    constexpr auto KERNEL_SYMBOL = "fc_kernel";
+    constexpr auto HASH_SYMBOL = "fc_kernel_hash";
+    constexpr auto SIZE_SYMBOL = "fc_kernel_size";
+    constexpr auto INPUTS_SYMBOL = "fc_kernel_inputs";
+    constexpr auto CACHE_NAME = "oop2_ex03_jit";
+
+    // The matrix an input of a node reads: one of the kernel inputs, or
+    // the result of the first operation of a composition on its own inputs
+    struct Binding
+    {
+        int input = 0;
+        const Operation* operation = nullptr;
+        std::vector<Binding> inputs;
+    };
+
+    // Writes the statements computing one element of a tree, at (i, j) or at
+    // (j, i) under an odd number of transposes, and returns the variable holding it
+    class ElementWriter
+    {
+    public:
+        explicit ElementWriter(std::ostream& ostr) : m_ostr(ostr) {}
+
+        std::string value(const Operation& operation, bool transposed, std::span<const Binding> inputs)
+        {
+            const auto children = operation.children();
+            switch (operation.info().kind)
+            {
+            case OperationKind::Identity:
+                return read(inputs.front(), transposed);
+            case OperationKind::Transpose:
+                return read(inputs.front(), !transposed);
+            case OperationKind::Scalar:
+                return checked(read(inputs.front(), transposed) + " * u64("
+                    + std::to_string(static_cast<const Scalar&>(operation).scalar()) + "LL)");
+            case OperationKind::Add:
+            case OperationKind::Sub:
+            {
+                const auto firstCount = static_cast<std::size_t>(children[0]->inputCount());
+                const auto a = value(*children[0], transposed, inputs.first(firstCount));
+                const auto b = value(*children[1], transposed, inputs.subspan(firstCount));
+                return checked(a + (operation.info().kind == OperationKind::Add ? " + " : " - ") + b);
+            }
+            case OperationKind::Comp:
+            {
+                const auto firstCount = static_cast<std::size_t>(children[0]->inputCount());
+                auto secondInputs = std::vector<Binding>{ Binding{ 0, children[0].get(),
+                    std::vector<Binding>(inputs.begin(), inputs.begin() + static_cast<std::ptrdiff_t>(firstCount)) } };
+                secondInputs.insert(secondInputs.end(), inputs.begin() + static_cast<std::ptrdiff_t>(firstCount), inputs.end());
+                return value(*children[1], transposed, secondInputs);
+            }
+            }
+            return {};
+        }
+
+    private:
+        std::ostream& m_ostr;
+        int m_variables = 0;
+
+        std::string read(const Binding& binding, bool transposed)
+        {
+            if (binding.operation)
+                return value(*binding.operation, transposed, binding.inputs);
+            return "load(in[" + std::to_string(binding.input) + (transposed ? "][j * N + i])" : "][i * N + j])");
+        }
+
+        // Unsigned arithmetic wraps instead of overflowing once a value left the
+        // range, which is then already recorded in the flag
+        std::string checked(const std::string& expression)
+        {
+            const auto name = "v" + std::to_string(m_variables++);
+            m_ostr << "            const u64 " << name << " = " << expression << ";\n"
+                << "            bad |= " << name << " - LOW > SPAN;\n";
+            return name;
+        }
+    };
+
+    // Operation kinds the generator knows how to write
+    bool isSupported(const Operation& operation)
+    {
+        if (operation.info().kind == OperationKind::Scalar && !dynamic_cast<const Scalar*>(&operation))
+            return false;
+        for (const auto& child : operation.children())
+            if (!isSupported(*child))
+                return false;
+        return true;
+    }
+
+#ifndef _WIN32
+    // Temporary files get names no other thread or process uses, so
+    // concurrent compilations of the same tree never write the same file
+    std::string temporarySuffix()
+    {
+        static auto counter = std::atomic<unsigned long>(0);
+        return ".tmp" + std::to_string(getpid()) + '-' + std::to_string(counter++);
+    }
+
+    // Objects in the cache are loaded as code, so the directory must be one that
+    // only this user can write to: it is created with mode 0700, and an existing
+    // one is refused unless this user owns it and nobody else may write to it
+    std::expected<void, std::string> usePrivateDirectory(const std::filesystem::path& path)
+    {
+        auto error = std::error_code();
+        if (path.has_parent_path())
+            std::filesystem::create_directories(path.parent_path(), error);
+        if (mkdir(path.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+            return std::unexpected("cannot create " + path.string() + ": " + std::strerror(errno));
+
+        struct stat info = {};
+        if (lstat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+            return std::unexpected(path.string() + " is not a directory");
+        if (info.st_uid != geteuid() || (info.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+            return std::unexpected("the cache directory " + path.string() + " is not private to this user");
+        return {};
+    }
+
+    std::string readFile(const std::filesystem::path& path)
+    {
+        auto file = std::ifstream(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // Writes a file under a name of its own and renames it, so other
+    // processes sharing the cache never see a partial file
+    bool writeFile(const std::filesystem::path& path, const std::string& contents)
+    {
+        auto temporary = path;
+        temporary += temporarySuffix();
+        {
+            auto file = std::ofstream(temporary, std::ios::binary);
+            if (!(file << contents))
+                return false;
+        }
+        auto error = std::error_code();
+        std::filesystem::rename(temporary, path, error);
+        return !error;
+    }
+
+    std::string shellQuote(const std::string& text)
+    {
+        auto quoted = std::string("'");
+        for (const char c : text)
+            quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        return quoted + "'";
+    }
+#endif
+}
+
+
+#ifdef _WIN32
+
+std::shared_ptr<NativeKernel> NativeKernel::load(const std::filesystem::path&, std::uint64_t, int, int)
+{
+    return nullptr;
+}
+
+NativeKernel::~NativeKernel() = default;
+
+#else
+
+std::shared_ptr<NativeKernel> NativeKernel::load(const std::filesystem::path& path, std::uint64_t hash, int size,
+    int inputCount)
+{
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+        return nullptr;
+
+    const auto* kernelHash = static_cast<const std::uint64_t*>(dlsym(handle, HASH_SYMBOL));
+    const auto* kernelSize = static_cast<const int*>(dlsym(handle, SIZE_SYMBOL));
+    const auto* kernelInputs = static_cast<const int*>(dlsym(handle, INPUTS_SYMBOL));
+    void* function = dlsym(handle, KERNEL_SYMBOL);
+    if (!kernelHash || !kernelSize || !kernelInputs || !function
+        || *kernelHash != hash || *kernelSize != size || *kernelInputs != inputCount)
+    {
+        dlclose(handle);
+        return nullptr;
+    }
+    return std::shared_ptr<NativeKernel>(new NativeKernel(handle, reinterpret_cast<Function>(function), size, inputCount));
+}
+
+NativeKernel::~NativeKernel()
+{
+    dlclose(m_handle);
+}
+
+#endif
+
+NativeKernel::NativeKernel(void* handle, Function function, int size, int inputCount)
+    : m_handle(handle), m_function(function), m_size(size), m_inputCount(inputCount)
+{
+}
+
+std::optional<Operation::T> NativeKernel::run(std::span<const Operation::T> inputs) const
+{
+    if (inputs.size() != static_cast<std::size_t>(m_inputCount))
+        return {};
+    for (const auto& input : inputs)
+        if (input.size() != m_size)
+            return {};
+
+    const auto elements = static_cast<std::size_t>(m_size) * static_cast<std::size_t>(m_size);
+    auto values = std::vector<int>(elements * (inputs.size() + 1));
+    auto pointers = std::vector<const int*>(inputs.size());
+
+    for (std::size_t k = 0; k < inputs.size(); ++k)
+    {
+        int* matrix = values.data() + k * elements;
+        for (int i = 0; i < m_size; ++i)
+            for (int j = 0; j < m_size; ++j)
+                matrix[i * m_size + j] = inputs[k](i, j);
+        pointers[k] = matrix;
+    }
+
+    int* output = values.data() + inputs.size() * elements;
+    if (m_function(pointers.data(), output) != 0)
+        return {};
+    return Operation::T(MatrixView<int>(output, m_size, m_size, 1));
+}
+
+
+JitCompiler::JitCompiler()
+    : JitCompiler([] {
+            if (const char* directory = std::getenv("FC_JIT_CACHE_DIR"); directory && *directory)
+                return std::filesystem::path(directory);
+            if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache && *cache)
+                return std::filesystem::path(cache) / CACHE_NAME;
+            if (const char* home = std::getenv("HOME"); home && *home)
+                return std::filesystem::path(home) / ".cache" / CACHE_NAME;
+            auto error = std::error_code();
+            auto name = std::string(CACHE_NAME);
+#ifndef _WIN32
+            name += '-' + std::to_string(geteuid());
+#endif
+            return std::filesystem::temp_directory_path(error) / name;
+        }())
+{
+}
+
+JitCompiler::JitCompiler(std::filesystem::path cacheDirectory)
+    : m_cacheDirectory(std::move(cacheDirectory))
+{
+}
+
+std::expected<std::string, std::string> JitCompiler::generateSource(const Operation& operation, int size)
+{
+    if (operation.info().nodeCount > MAX_NODES)
+        return std::unexpected("the tree has more than " + std::to_string(MAX_NODES) + " nodes");
+    if (!isSupported(operation))
+        return std::unexpected(std::string("the tree holds an operation the generator does not know"));
+
+    auto body = std::ostringstream();
+    auto writer = ElementWriter(body);
+    auto inputs = std::vector<Binding>(static_cast<std::size_t>(operation.inputCount()));
+    for (std::size_t k = 0; k < inputs.size(); ++k)
+        inputs[k].input = static_cast<int>(k);
+    const auto result = writer.value(operation, false, inputs);
+
+    auto source = std::ostringstream();
+    source << "// Generated by the 'jit' command, do not edit\n"
+        << "// ";
+    operation.print(source);
+    source << "\n// on " << size << "x" << size << " matrices\n"
+        << "#include <cstdint>\n\n"
+        << "namespace\n{\n"
+        << "    using u64 = std::uint64_t;\n"
+        << "    constexpr int N = " << size << ";\n"
+        << "    // v is in range when v - LOW <= SPAN, in unsigned arithmetic\n"
+        << "    constexpr u64 LOW = u64(" << MIN_ALLOWED_VALUE << "LL);\n"
+        << "    constexpr u64 SPAN = " << MAX_ALLOWED_VALUE - MIN_ALLOWED_VALUE << ";\n\n"
+        << "    inline u64 load(int value) { return u64(std::int64_t(value)); }\n"
+        << "}\n\n"
+        << "extern \"C\" const std::uint64_t " << HASH_SYMBOL << " = " << operation.info().hash << "ULL;\n"
+        << "extern \"C\" const int " << SIZE_SYMBOL << " = N;\n"
+        << "extern \"C\" const int " << INPUTS_SYMBOL << " = " << operation.inputCount() << ";\n\n"
+        << "extern \"C\" int " << KERNEL_SYMBOL << "(const int* const* in, int* out)\n{\n"
+        << "    u64 bad = 0;\n"
+        << "#pragma GCC unroll " << size << "\n"
+        << "    for (int i = 0; i < N; ++i)\n    {\n"
+        << "#pragma GCC unroll " << size << "\n"
+        << "        for (int j = 0; j < N; ++j)\n        {\n"
+        << body.str()
+        << "            out[i * N + j] = int(std::int64_t(" << result << "));\n"
+        << "        }\n    }\n"
+        << "    return bad != 0;\n}\n";
+    return source.str();
+}
+
+std::expected<JitCompiler::Compiled, std::string> JitCompiler::compile(const std::shared_ptr<Operation>& operation, int size)
+{
+#ifdef _WIN32
+    (void)operation;
+    (void)size;
+    return std::unexpected(std::string("native compilation is only supported on POSIX systems"));
+#else
+    const auto start = std::chrono::steady_clock::now();
+    const auto source = generateSource(*operation, size);
+    if (!source)
+        return std::unexpected(source.error());
+
+    if (const auto directory = usePrivateDirectory(m_cacheDirectory); !directory)
+        return std::unexpected(directory.error());
+
+    const auto hash = operation->info().hash;
+    auto name = std::ostringstream();
+    name << "kernel-v" << GENERATOR_VERSION << '-' << std::hex << hash << std::dec << '-' << size;
+    const auto base = m_cacheDirectory / name.str();
+    auto sourcePath = base, libraryPath = base, logPath = base;
+    sourcePath += ".cpp";
+    libraryPath += ".so";
+    logPath += ".log";
+
+    const auto inputCount = operation->inputCount();
+    auto error = std::error_code();
+    auto kernel = std::shared_ptr<NativeKernel>();
+    if (std::filesystem::exists(libraryPath, error) && readFile(sourcePath) == *source)
+        kernel = NativeKernel::load(libraryPath, hash, size, inputCount);
+    const bool cached = kernel != nullptr;
+    if (!kernel)
+    {
+        if (!writeFile(sourcePath, *source))
+            return std::unexpected("cannot write " + sourcePath.string());
+
+        const char* compiler = std::getenv("CXX");
+        auto temporary = libraryPath;
+        temporary += temporarySuffix();
+        const auto command = shellQuote(compiler && *compiler ? compiler : "c++")
+            + " -std=c++17 -O3 -fPIC -shared -o " + shellQuote(temporary.string()) + ' ' + shellQuote(sourcePath.string())
+            + " > " + shellQuote(logPath.string()) + " 2>&1";
+        if (std::system(command.c_str()) != 0)
+            return std::unexpected("the compiler failed, see " + logPath.string());
+
+        std::filesystem::rename(temporary, libraryPath, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            return std::unexpected("cannot write " + libraryPath.string());
+        }
+        kernel = NativeKernel::load(libraryPath, hash, size, inputCount);
+        if (!kernel)
+            return std::unexpected("cannot load " + libraryPath.string());
+    }
+
+    // Routes of deleted operations are dropped here, before their addresses may be reused
+    std::erase_if(m_routes, [](const auto& entry) { return entry.second.operation.expired(); });
+    m_routes[{ operation.get(), size }] = Route{ operation, kernel };
+    return Compiled{ libraryPath, cached,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+#endif
+}
+
+Operation::Result JitCompiler::evaluate(const Operation& operation, std::span<const Operation::T> inputs) const
+{
+    if (!inputs.empty())
+        if (const auto kernel = kernelFor(operation, inputs.front().size()))
+            if (auto result = kernel->run(inputs))
+                return std::move(*result);
+    return operation.evaluate(inputs);
+}
+
+std::shared_ptr<const NativeKernel> JitCompiler::kernelFor(const Operation& operation, int size) const
+{
+    const auto found = m_routes.find({ &operation, size });
+    if (found == m_routes.end() || found->second.operation.expired())
+        return nullptr;
+    return found->second.kernel;
+}
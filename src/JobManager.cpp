@@ -0,0 +1,111 @@
+#include "JobManager.h"
+#include "EvalContext.h"
+#include "JitCompiler.h"
+
+#include <chrono>
+#include <algorithm>
+#include <exception>
+
+
+const char* statusName(JobManager::Status status)
+{
+    switch (status)
+    {
+    case JobManager::Status::Running: return "running";
+    case JobManager::Status::Done:    return "done";
+    case JobManager::Status::Failed:  return "failed";
+    default:                          return "cancelled";
+    }
+}
+
+
+JobManager::Job::Job(std::size_t id, std::shared_ptr<Operation> operation, std::vector<Operation::T> inputs,
+    std::shared_ptr<const NativeKernel> kernel)
+    : m_id(id), m_operation(std::move(operation)), m_inputs(std::move(inputs)), m_kernel(std::move(kernel))
+{
+}
+
+JobManager::Status JobManager::Job::status() const
+{
+    auto lock = std::lock_guard(m_mutex);
+    if (!m_result)
+        return Status::Running;
+    if (!m_failure.empty())
+        return Status::Failed;
+    if (!*m_result && m_result->error().code == MatrixErrorCode::Cancelled)
+        return Status::Cancelled;
+    return Status::Done;
+}
+
+void JobManager::Job::wait() const
+{
+    auto lock = std::unique_lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_result.has_value(); });
+}
+
+void JobManager::Job::finish(Operation::Result result, std::string failure, double seconds)
+{
+    {
+        auto lock = std::lock_guard(m_mutex);
+        m_result = std::move(result);
+        m_failure = std::move(failure);
+        m_seconds = seconds;
+    }
+    m_finished.notify_all();
+}
+
+
+JobManager::~JobManager()
+{
+    for (auto& [id, job] : m_jobs)
+        job->cancel();
+    // m_pool is destroyed first and, unless it is shared, joins the workers after the jobs ended
+}
+
+std::shared_ptr<ThreadPool> JobManager::makePool()
+{
+    return std::make_shared<ThreadPool>(std::max(MIN_WORKERS, std::thread::hardware_concurrency()));
+}
+
+std::size_t JobManager::submit(std::shared_ptr<Operation> operation, std::vector<Operation::T> inputs,
+    std::shared_ptr<const NativeKernel> kernel)
+{
+    if (!m_pool)
+        m_pool = makePool();
+
+    const auto id = m_nextId++;
+    auto job = std::make_shared<Job>(id, std::move(operation), std::move(inputs), std::move(kernel));
+    m_jobs.emplace(id, job);
+    run(std::move(job), *m_pool);
+    return id;
+}
+
+std::shared_ptr<JobManager::Job> JobManager::find(std::size_t id) const
+{
+    const auto it = m_jobs.find(id);
+    return it == m_jobs.end() ? nullptr : it->second;
+}
+
+DetachedTask JobManager::run(std::shared_ptr<Job> job, ThreadPool& pool)
+{
+    co_await pool.schedule();
+
+    const auto start = std::chrono::steady_clock::now();
+    auto result = Operation::Result(std::unexpected(MatrixError{ MatrixErrorCode::Cancelled }));
+    auto failure = std::string();
+    try {
+        auto compiled = job->m_kernel ? job->m_kernel->run(job->m_inputs) : std::nullopt;
+        if (compiled)
+            result = std::move(*compiled);
+        else
+        {
+            const auto context = EvalContext(job->m_cancelled);
+            result = job->m_operation->evaluate(job->m_inputs);
+        }
+    }
+    catch (const std::exception& e) {
+        failure = e.what();
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    job->finish(std::move(result), std::move(failure), seconds);
+}
@@ -0,0 +1,59 @@
+#include "LatencyHistogram.h"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+    const auto nanoseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+    m_buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::count() const
+{
+    std::uint64_t total = 0;
+    for (const auto& bucket : m_buckets)
+        total += bucket.load(std::memory_order_relaxed);
+    return total;
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double fraction) const
+{
+    const auto total = count();
+    if (total == 0)
+        return {};
+
+    const auto target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return std::chrono::nanoseconds(upperBoundOf(i));
+    }
+    return std::chrono::nanoseconds(upperBoundOf(BUCKET_COUNT - 1));
+}
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t nanoseconds)
+{
+    if (nanoseconds < SUB_BUCKETS)
+        return static_cast<std::size_t>(nanoseconds);
+
+    // The leading bit picks the power of two, the next SUB_BITS bits the bucket inside it
+    const auto exponent = static_cast<std::size_t>(std::bit_width(nanoseconds)) - 1;
+    const auto sub = static_cast<std::size_t>(nanoseconds >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t LatencyHistogram::upperBoundOf(std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    const auto exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    const auto sub = bucket % SUB_BUCKETS;
+    const auto width = std::uint64_t(1) << (exponent - SUB_BITS);
+    return ((SUB_BUCKETS + sub) << (exponent - SUB_BITS)) + width - 1;
+}
@@ -0,0 +1,36 @@
+#include "MatrixError.h"
+#include "SquareMatrix.h"
+
+#include <iostream>
+#include <sstream>
+
+
+std::ostream& operator<<(std::ostream& ostr, const MatrixError& error)
+{
+    switch (error.code)
+    {
+    case MatrixErrorCode::ComputedOutOfRange:
+        ostr << "Computed matrix value " << error.value << " at (" << error.row << ", " << error.col
+            << ") of operation '" << error.op << "' is out of range";
+        break;
+    case MatrixErrorCode::InputOutOfRange:
+        ostr << "Matrix element " << error.value << " at (" << error.row << ", " << error.col
+            << ") out of allowed range";
+        break;
+    case MatrixErrorCode::NotANumber:
+        return ostr << "Expected numeric matrix element at (" << error.row << ", " << error.col << ").";
+    case MatrixErrorCode::Cancelled:
+        return ostr << "Evaluation was cancelled.";
+    case MatrixErrorCode::MissingInputs:
+        return ostr << "Operation expects " << error.inputCount << " input matrices, got " << error.value << '.';
+    }
+    return ostr << " [" << MIN_ALLOWED_VALUE << ", " << MAX_ALLOWED_VALUE << "]";
+}
+
+
+std::string toString(const MatrixError& error)
+{
+    std::ostringstream ostr;
+    ostr << error;
+    return ostr.str();
+}
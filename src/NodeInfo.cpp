@@ -0,0 +1,66 @@
+#include "NodeInfo.h"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace
+{
+    std::uint64_t saturatingAdd(std::uint64_t a, std::uint64_t b)
+    {
+        return a > std::numeric_limits<std::uint64_t>::max() - b ? std::numeric_limits<std::uint64_t>::max() : a + b;
+    }
+
+    // splitmix64 finalizer
+    std::uint64_t mix(std::uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+}
+
+
+CostEstimate NodeInfo::estimate(int n) const
+{
+    const double elements = static_cast<double>(n) * static_cast<double>(n);
+    return { static_cast<double>(opsPerElement) * elements,
+        static_cast<double>(accessesPerElement) * elements * static_cast<double>(sizeof(int)) };
+}
+
+
+NodeInfo NodeInfo::leaf(OperationKind kind, std::int64_t parameter)
+{
+    auto info = NodeInfo();
+    info.kind = kind;
+    info.hash = mix(static_cast<std::uint64_t>(kind) ^ mix(static_cast<std::uint64_t>(parameter)));
+    // Identity and transpose share the input storage, a scalar reads and writes every element
+    if (kind == OperationKind::Scalar)
+    {
+        info.opsPerElement = 1;
+        info.accessesPerElement = 2;
+    }
+    return info;
+}
+
+
+NodeInfo NodeInfo::combine(OperationKind kind, const NodeInfo& first, const NodeInfo& second)
+{
+    auto info = NodeInfo();
+    info.kind = kind;
+    // Composition feeds the result of the first operation into one input of the second
+    const auto inputCount = static_cast<std::int64_t>(first.inputCount) + second.inputCount - (kind == OperationKind::Comp ? 1 : 0);
+    info.inputCount = static_cast<int>(std::min<std::int64_t>(inputCount, MAX_INPUT_COUNT));
+    info.depth = 1 + std::max(first.depth, second.depth);
+    info.nodeCount = saturatingAdd(1, saturatingAdd(first.nodeCount, second.nodeCount));
+    info.hash = mix(mix(static_cast<std::uint64_t>(kind) ^ first.hash) ^ (second.hash * 31));
+    info.opsPerElement = saturatingAdd(first.opsPerElement, second.opsPerElement);
+    info.accessesPerElement = saturatingAdd(first.accessesPerElement, second.accessesPerElement);
+    if (kind != OperationKind::Comp)
+    {
+        info.opsPerElement = saturatingAdd(info.opsPerElement, 1);
+        info.accessesPerElement = saturatingAdd(info.accessesPerElement, 3);
+    }
+    return info;
+}
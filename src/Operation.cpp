@@ -1,6 +1,45 @@
 #include "Operation.h"
+#include "EvalContext.h"
 
 #include <iostream>
+#include <stdexcept>
+#include <string>
+
+
+Operation::Operation(const NodeInfo& info)
+    : m_info(info)
+{
+}
+
+
+Operation::Result Operation::evaluate(std::span<const T> input) const
+{
+    // Operations split the inputs by the counts of their children, so too few inputs would be read past the end
+    if (inputCount() < 1 || input.size() < static_cast<std::size_t>(inputCount()))
+        return std::unexpected(MatrixError{ MatrixErrorCode::MissingInputs, 0, 0,
+            static_cast<long long>(input.size()), '\0', inputCount() });
+    if (EvalContext::isCancelled())
+        return std::unexpected(MatrixError{ MatrixErrorCode::Cancelled });
+#ifdef FC_ENABLE_PROFILING
+    const auto scope = profiling::NodeScope(*this, m_counters);
+#endif
+    return tryCompute(input);
+}
+
+
+Operation::T Operation::compute(const std::vector<T>& input) const
+{
+    auto result = evaluate(input);
+    if (!result)
+        throw std::invalid_argument(toString(result.error()));
+    return std::move(*result);
+}
+
+
+void Operation::printNode(std::ostream& ostr, bool first_print, const ChildPrinter&) const
+{
+	print(ostr, first_print);
+}
 
 
 void Operation::print(std::ostream& ostr, const std::vector<T>& input) const
@@ -0,0 +1,198 @@
+#include "Profiler.h"
+
+#ifdef FC_ENABLE_PROFILING
+
+#include "Operation.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+namespace profiling
+{
+    namespace
+    {
+        constexpr std::size_t MAX_LABEL_LENGTH = 60;
+
+        std::uint64_t nanosecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+        }
+
+        // The distinct nodes of a tree, each once
+        std::vector<const Operation*> distinctNodes(const Operation& root)
+        {
+            auto seen = std::unordered_set<const Operation*>{ &root };
+            auto nodes = std::vector<const Operation*>{ &root };
+            for (std::size_t i = 0; i < nodes.size(); ++i)
+                for (const auto& child : nodes[i]->children())
+                    if (seen.insert(child.get()).second)
+                        nodes.push_back(child.get());
+            return nodes;
+        }
+
+        void writeJsonString(std::ostream& ostr, const std::string& text)
+        {
+            ostr << '"';
+            for (const char c : text)
+            {
+                if (c == '"' || c == '\\')
+                    ostr << '\\';
+                ostr << c;
+            }
+            ostr << '"';
+        }
+    }
+
+
+    void NodeCounters::reset()
+    {
+        calls = 0;
+        nanoseconds = 0;
+        bytesAllocated = 0;
+        matricesCopied = 0;
+    }
+
+    void GlobalCounters::reset()
+    {
+        renderCacheHits = 0;
+        renderCacheMisses = 0;
+        parsedMatrices = 0;
+        parseNanoseconds = 0;
+        formattedResults = 0;
+        formatNanoseconds = 0;
+    }
+
+    GlobalCounters& globalCounters()
+    {
+        static auto counters = GlobalCounters();
+        return counters;
+    }
+
+
+    TraceRecorder::TraceRecorder()
+        : m_origin(std::chrono::steady_clock::now()), m_previous(t_current)
+    {
+        t_current = this;
+    }
+
+    TraceRecorder::~TraceRecorder()
+    {
+        t_current = m_previous;
+    }
+
+    void TraceRecorder::writeChromeTrace(std::ostream& ostr) const
+    {
+        ostr << "{\"traceEvents\": [\n";
+        for (std::size_t i = 0; i < m_events.size(); ++i)
+        {
+            const auto& event = m_events[i];
+            ostr << "  {\"name\": ";
+            writeJsonString(ostr, nodeLabel(*event.node));
+            ostr << ", \"cat\": \"" << kindName(event.node->info().kind) << "\", \"ph\": \"X\""
+                << std::fixed << std::setprecision(3)
+                << ", \"ts\": " << static_cast<double>(event.startNanoseconds) / 1000
+                << ", \"dur\": " << static_cast<double>(event.durationNanoseconds) / 1000
+                << std::defaultfloat << ", \"pid\": 1, \"tid\": 1, \"args\": {\"depth\": " << event.depth << "}}"
+                << (i + 1 < m_events.size() ? ",\n" : "\n");
+        }
+        ostr << "], \"displayTimeUnit\": \"ns\"}\n";
+    }
+
+
+    NodeScope::NodeScope(const Operation& node, NodeCounters& counters)
+        : m_counters(counters), m_trace(TraceRecorder::t_current)
+    {
+        const auto previousCalls = counters.calls.fetch_add(1, std::memory_order_relaxed);
+        if (previousCalls < SAMPLE_INTERVAL)
+            m_weight = 1;
+        else if (++t_sampleTick % SAMPLE_INTERVAL == 0)
+            m_weight = SAMPLE_INTERVAL;
+        if (m_weight == 0 && !m_trace)
+            return;
+
+        m_start = std::chrono::steady_clock::now();
+        m_before = t_threadCounters;
+        if (m_trace)
+        {
+            // The event is opened now so that parents precede their children in the trace
+            m_traceIndex = m_trace->m_events.size();
+            m_trace->m_events.push_back({ &node, nanosecondsBetween(m_trace->m_origin, m_start), 0, m_trace->m_depth++ });
+        }
+    }
+
+    NodeScope::~NodeScope()
+    {
+        if (m_weight == 0 && !m_trace)
+            return;
+
+        const auto elapsed = nanosecondsBetween(m_start, std::chrono::steady_clock::now());
+        if (m_weight > 0)
+        {
+            m_counters.nanoseconds.fetch_add(elapsed * m_weight, std::memory_order_relaxed);
+            if (const auto bytes = t_threadCounters.bytesAllocated - m_before.bytesAllocated; bytes > 0)
+                m_counters.bytesAllocated.fetch_add(bytes * m_weight, std::memory_order_relaxed);
+            if (const auto copies = t_threadCounters.matricesCopied - m_before.matricesCopied; copies > 0)
+                m_counters.matricesCopied.fetch_add(copies * m_weight, std::memory_order_relaxed);
+        }
+        if (m_trace)
+        {
+            m_trace->m_events[m_traceIndex].durationNanoseconds = elapsed;
+            --m_trace->m_depth;
+        }
+    }
+
+
+    ScopedTimer::ScopedTimer(std::atomic<std::uint64_t>& target)
+        : m_target(target), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ScopedTimer::~ScopedTimer()
+    {
+        m_target.fetch_add(nanosecondsBetween(m_start, std::chrono::steady_clock::now()), std::memory_order_relaxed);
+    }
+
+
+    std::string nodeLabel(const Operation& node)
+    {
+        auto label = std::ostringstream();
+        if (node.isRenderingCached())
+        {
+            node.print(label, true);
+            if (label.tellp() <= static_cast<std::streamoff>(MAX_LABEL_LENGTH))
+                return label.str();
+            label.str({});
+        }
+        label << kindName(node.info().kind) << " #" << std::hex << (node.info().hash & 0xffffff);
+        return label.str();
+    }
+
+    void printNodeStats(std::ostream& ostr, const Operation& root)
+    {
+        ostr << std::setw(10) << "calls" << std::setw(12) << "total ms" << std::setw(12) << "avg us"
+            << std::setw(14) << "bytes" << std::setw(10) << "copies" << "  node\n";
+        for (const auto* node : distinctNodes(root))
+        {
+            const auto& counters = node->counters();
+            const auto calls = counters.calls.load();
+            const auto nanoseconds = static_cast<double>(counters.nanoseconds.load());
+            ostr << std::setw(10) << calls
+                << std::setw(12) << nanoseconds / 1e6
+                << std::setw(12) << (calls ? nanoseconds / static_cast<double>(calls) / 1e3 : 0.0)
+                << std::setw(14) << counters.bytesAllocated.load()
+                << std::setw(10) << counters.matricesCopied.load()
+                << "  " << nodeLabel(*node) << '\n';
+        }
+    }
+
+    void resetNodeStats(const Operation& root)
+    {
+        for (const auto* node : distinctNodes(root))
+            node->counters().reset();
+    }
+}
+
+#endif
@@ -2,13 +2,12 @@
 #include <stdexcept>
 #include <string>
 
-void ReadCommand::run(FunctionCalculator& calc, std::istream& args)
+void ReadCommand::run(FunctionCalculator& calc, Tokenizer& args)
 {
-    std::string filePath;
-    args >> filePath;
+    const auto filePath = args.next();
 
     if (filePath.empty())
         throw std::invalid_argument("No file path provided.");
 
-    calc.executeFromFile(filePath);
+    calc.executeFromFile(std::string(filePath));
 }
@@ -4,14 +4,14 @@
 
 
 Scalar::Scalar(int scalar)
- : m_scalar(scalar)
+ : UnaryOperation(OperationKind::Scalar, scalar), m_scalar(scalar)
 {
 }
 
 
-Operation::T Scalar::compute(const std::vector<T>& input) const
+Operation::Result Scalar::tryCompute(std::span<const T> input) const
 {
-    return input.front() * m_scalar;
+    return input.front().tryScale(m_scalar);
 }
 
 
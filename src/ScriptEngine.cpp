@@ -0,0 +1,89 @@
+#include "ScriptEngine.h"
+#include "FunctionCalculator.h"
+#include "MappedFile.h"
+#include "Tokenizer.h"
+
+#include <iostream>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+
+std::optional<ErrorPolicy> parseErrorPolicy(std::string_view name)
+{
+    if (name == "abort")
+        return ErrorPolicy::Abort;
+    if (name == "skip")
+        return ErrorPolicy::Skip;
+    if (name == "collect")
+        return ErrorPolicy::Collect;
+    return {};
+}
+
+std::ostream& operator<<(std::ostream& ostr, const ScriptReport& report)
+{
+    ostr << report.commands << " commands in " << report.seconds * 1000 << " ms";
+    if (report.seconds > 0)
+        ostr << " (" << static_cast<long long>(report.commandsPerSecond()) << " commands/s)";
+    return ostr << ", " << report.failed << " failed";
+}
+
+
+ScriptEngine::ScriptEngine(FunctionCalculator& calculator, ErrorPolicy policy, std::ostream& errors)
+    : m_calculator(calculator), m_policy(policy), m_errors(errors), m_wasInteractive(calculator.isInteractive())
+{
+    m_calculator.setInteractive(false);
+}
+
+ScriptEngine::~ScriptEngine()
+{
+    m_calculator.setInteractive(m_wasInteractive);
+}
+
+ScriptReport ScriptEngine::runFile(const std::string& path)
+{
+    const auto file = MappedFile(path);
+    return runText(file.contents());
+}
+
+ScriptReport ScriptEngine::runText(std::string_view script)
+{
+    auto report = ScriptReport();
+    const auto start = std::chrono::steady_clock::now();
+
+    // Returns false when the policy stops the script
+    const auto fail = [&](std::size_t lineNumber, const auto& error)
+    {
+        ++report.failed;
+        if (m_policy == ErrorPolicy::Collect)
+        {
+            auto message = std::ostringstream();
+            message << error;
+            report.errors.push_back({ lineNumber, message.str() });
+            return true;
+        }
+
+        m_errors << "Error (line " << lineNumber << "): " << error << '\n';
+        report.aborted = m_policy == ErrorPolicy::Abort;
+        return !report.aborted;
+    };
+
+    forEachLine(script, [&](std::string_view line, std::size_t lineNumber)
+        {
+            if (Tokenizer(line).atEnd())
+                return true;
+
+            ++report.commands;
+            try {
+                if (auto result = m_calculator.executeSingleCommand(line); !result)
+                    return fail(lineNumber, result.error());
+            }
+            catch (const std::exception& e) {
+                return fail(lineNumber, e.what());
+            }
+            return m_calculator.isRunning();
+        });
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
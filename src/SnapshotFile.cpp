@@ -0,0 +1,276 @@
+#include "SnapshotFile.h"
+#include "MappedFile.h"
+#include "Add.h"
+#include "Sub.h"
+#include "Comp.h"
+#include "Identity.h"
+#include "Transpose.h"
+#include "Scalar.h"
+
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+
+namespace
+{
+    constexpr std::string_view MAGIC = "FCALCREG";
+    constexpr std::size_t HEADER_SIZE = MAGIC.size() + 4 + 8 + 8;
+    constexpr std::uint32_t NO_NODE = UINT32_MAX;
+
+    std::uint64_t checksum(std::string_view bytes)
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char c : bytes)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        return hash;
+    }
+
+    void putU8(std::string& out, std::uint8_t value)
+    {
+        out.push_back(static_cast<char>(value));
+    }
+
+    template <typename Int>
+    void putInt(std::string& out, Int value)
+    {
+        const auto bits = static_cast<std::uint64_t>(value);
+        for (std::size_t i = 0; i < sizeof(Int); ++i)
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+
+    // Reads the little endian fields of a buffer, any read past its end
+    // returns zero and marks the reader as failed
+    class ByteReader
+    {
+    public:
+        explicit ByteReader(std::string_view bytes) : m_rest(bytes) {}
+
+        bool ok() const { return m_ok; }
+        bool atEnd() const { return m_rest.empty(); }
+
+        template <typename Int>
+        Int get()
+        {
+            if (m_rest.size() < sizeof(Int))
+            {
+                m_ok = false;
+                m_rest = {};
+                return 0;
+            }
+            std::uint64_t bits = 0;
+            for (std::size_t i = 0; i < sizeof(Int); ++i)
+                bits |= std::uint64_t(static_cast<unsigned char>(m_rest[i])) << (8 * i);
+            m_rest.remove_prefix(sizeof(Int));
+            return static_cast<Int>(bits);
+        }
+
+        std::string_view bytes(std::size_t count)
+        {
+            if (m_rest.size() < count)
+            {
+                m_ok = false;
+                m_rest = {};
+                return {};
+            }
+            const auto result = m_rest.substr(0, count);
+            m_rest.remove_prefix(count);
+            return result;
+        }
+
+    private:
+        std::string_view m_rest;
+        bool m_ok = true;
+    };
+
+    [[noreturn]] void corrupt(const std::string& path, const std::string& reason)
+    {
+        throw std::invalid_argument("Invalid snapshot file " + path + ": " + reason);
+    }
+
+    // Numbers the distinct nodes reachable from the registry, children first
+    // The walk keeps its own stack, so deep chains of compositions cannot overflow the call stack
+    std::vector<const Operation*> collectNodes(const FunctionCalculator::OperationList& operations,
+        std::unordered_map<const Operation*, std::uint32_t>& numbers)
+    {
+        auto order = std::vector<const Operation*>();
+        auto stack = std::vector<std::pair<const Operation*, std::size_t>>();
+
+        for (std::size_t i = 0; i < operations.slotCount(); ++i)
+        {
+            const auto root = operations.slotRecord(i).operation;
+            if (!root || numbers.contains(root.get()))
+                continue;
+
+            stack.emplace_back(root.get(), 0);
+            while (!stack.empty())
+            {
+                auto& [node, next] = stack.back();
+                const auto children = node->children();
+                if (next < children.size())
+                {
+                    const auto* child = children[next++].get();
+                    if (!numbers.contains(child))
+                        stack.emplace_back(child, 0);
+                    continue;
+                }
+
+                numbers.emplace(node, static_cast<std::uint32_t>(order.size()));
+                order.push_back(node);
+                stack.pop_back();
+            }
+        }
+        return order;
+    }
+
+    std::shared_ptr<Operation> makeNode(OperationKind kind, ByteReader& reader,
+        const std::vector<std::shared_ptr<Operation>>& nodes)
+    {
+        switch (kind)
+        {
+        case OperationKind::Identity:  return std::make_shared<Identity>();
+        case OperationKind::Transpose: return std::make_shared<Transpose>();
+        case OperationKind::Scalar:    return std::make_shared<Scalar>(reader.get<std::int32_t>());
+        case OperationKind::Add:
+        case OperationKind::Sub:
+        case OperationKind::Comp:
+            break;
+        default:
+            return nullptr;
+        }
+
+        // Children always precede their parent, which also rules out cycles
+        const auto first = reader.get<std::uint32_t>();
+        const auto second = reader.get<std::uint32_t>();
+        if (!reader.ok() || first >= nodes.size() || second >= nodes.size())
+            return nullptr;
+        if (kind == OperationKind::Add)
+            return std::make_shared<Add>(nodes[first], nodes[second]);
+        if (kind == OperationKind::Sub)
+            return std::make_shared<Sub>(nodes[first], nodes[second]);
+        return std::make_shared<Comp>(nodes[first], nodes[second]);
+    }
+}
+
+
+void SnapshotFile::save(const std::string& path, const FunctionCalculator::Snapshot& state)
+{
+    const auto& operations = state.operations;
+    auto numbers = std::unordered_map<const Operation*, std::uint32_t>();
+    const auto nodes = collectNodes(operations, numbers);
+
+    auto payload = std::string();
+    putInt<std::uint32_t>(payload, static_cast<std::uint32_t>(state.maxFunctions));
+    putInt<std::uint32_t>(payload, static_cast<std::uint32_t>(nodes.size()));
+    for (const auto* node : nodes)
+    {
+        const auto kind = node->info().kind;
+        putU8(payload, static_cast<std::uint8_t>(kind));
+        if (kind == OperationKind::Scalar)
+            putInt<std::int32_t>(payload, static_cast<const Scalar*>(node)->scalar());
+        for (const auto& child : node->children())
+            putInt<std::uint32_t>(payload, numbers.at(child.get()));
+    }
+
+    putInt<std::uint32_t>(payload, static_cast<std::uint32_t>(operations.slotCount()));
+    for (std::size_t i = 0; i < operations.slotCount(); ++i)
+    {
+        const auto record = operations.slotRecord(i);
+        putInt<std::uint32_t>(payload, record.generation);
+        putInt<std::uint32_t>(payload, record.operation ? numbers.at(record.operation.get()) : NO_NODE);
+        putInt<std::uint32_t>(payload, static_cast<std::uint32_t>(record.name.size()));
+        payload += record.name;
+    }
+
+    auto header = std::string(MAGIC);
+    putInt<std::uint32_t>(header, VERSION);
+    putInt<std::uint64_t>(header, payload.size());
+    putInt<std::uint64_t>(header, checksum(payload));
+
+    // Written next to the target and renamed over it, so a failed write never
+    // destroys the previous snapshot. The thread is part of the name because
+    // server sessions may save to the same path at once
+    const auto temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    auto file = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    file.close();
+
+    auto error = std::error_code();
+    if (file.fail() || (std::filesystem::rename(temporary, path, error), error))
+    {
+        std::filesystem::remove(temporary, error);
+        throw std::invalid_argument("Failed to write file: " + path);
+    }
+}
+
+FunctionCalculator::Snapshot SnapshotFile::load(const std::string& path)
+{
+    const auto file = MappedFile(path);
+    const auto contents = file.contents();
+    if (contents.size() < HEADER_SIZE || contents.substr(0, MAGIC.size()) != MAGIC)
+        corrupt(path, "not a function list snapshot");
+
+    auto header = ByteReader(contents.substr(MAGIC.size(), HEADER_SIZE - MAGIC.size()));
+    const auto version = header.get<std::uint32_t>();
+    const auto payloadSize = header.get<std::uint64_t>();
+    const auto expectedChecksum = header.get<std::uint64_t>();
+    if (version != VERSION)
+        corrupt(path, "version " + std::to_string(version) + " is not supported");
+    const auto payload = contents.substr(HEADER_SIZE);
+    if (payload.size() != payloadSize || checksum(payload) != expectedChecksum)
+        corrupt(path, "checksum mismatch");
+
+    auto reader = ByteReader(payload);
+    const auto maxFunctions = reader.get<std::uint32_t>();
+    if (maxFunctions < 2 || maxFunctions > FunctionCalculator::MAX_FUNCTIONS_LIMIT)
+        corrupt(path, "invalid function limit");
+
+    // Counts are checked against the bytes left before anything is allocated for them
+    const auto nodeCount = reader.get<std::uint32_t>();
+    if (nodeCount > payload.size())
+        corrupt(path, "truncated node table");
+    auto nodes = std::vector<std::shared_ptr<Operation>>();
+    nodes.reserve(nodeCount);
+    for (std::uint32_t i = 0; i < nodeCount; ++i)
+    {
+        auto node = makeNode(static_cast<OperationKind>(reader.get<std::uint8_t>()), reader, nodes);
+        if (!node || !reader.ok())
+            corrupt(path, "invalid node #" + std::to_string(i));
+        nodes.push_back(std::move(node));
+    }
+
+    const auto slotCount = reader.get<std::uint32_t>();
+    if (slotCount > payload.size())
+        corrupt(path, "truncated slot table");
+    auto slots = std::vector<FunctionRegistry::SlotRecord>(slotCount);
+    std::size_t liveCount = 0;
+    for (auto& slot : slots)
+    {
+        slot.generation = reader.get<std::uint32_t>();
+        const auto node = reader.get<std::uint32_t>();
+        slot.name = reader.bytes(reader.get<std::uint32_t>());
+        if (node != NO_NODE)
+        {
+            if (node >= nodes.size())
+                corrupt(path, "function refers to a missing node");
+            slot.operation = nodes[node];
+            ++liveCount;
+        }
+    }
+    if (!reader.ok() || !reader.atEnd())
+        corrupt(path, "truncated or oversized slot table");
+    if (liveCount > maxFunctions)
+        corrupt(path, "more functions than the function limit");
+
+    auto operations = FunctionRegistry::fromSlots(slots);
+    if (!operations)
+        corrupt(path, "invalid or duplicate function name");
+    return { std::move(*operations), static_cast<int>(maxFunctions) };
+}
@@ -0,0 +1,46 @@
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+    m_workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+        m_workers.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        auto lock = std::lock_guard(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void ThreadPool::post(std::function<void()> work)
+{
+    {
+        auto lock = std::lock_guard(m_mutex);
+        m_queue.push_back(std::move(work));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        auto next = std::function<void()>();
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty())
+                return;
+            next = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        next();
+    }
+}
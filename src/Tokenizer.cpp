@@ -0,0 +1,72 @@
+#include "Tokenizer.h"
+
+#include <charconv>
+
+
+namespace
+{
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+}
+
+
+Tokenizer::Tokenizer(std::string_view line)
+    : m_rest(line)
+{
+    skipSpaces();
+}
+
+
+std::string_view Tokenizer::next()
+{
+    std::size_t length = 0;
+    while (length < m_rest.size() && !isSpace(m_rest[length]))
+        ++length;
+
+    const auto token = m_rest.substr(0, length);
+    m_rest.remove_prefix(length);
+    skipSpaces();
+    return token;
+}
+
+
+std::optional<int> Tokenizer::nextInt()
+{
+    const auto token = next();
+    int value = 0;
+    const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || error != std::errc() || end != token.data() + token.size())
+        return {};
+    return value;
+}
+
+
+std::size_t Tokenizer::remaining() const
+{
+    std::size_t count = 0;
+    bool inToken = false;
+    for (const char c : m_rest)
+    {
+        if (!isSpace(c) && !inToken)
+            ++count;
+        inToken = !isSpace(c);
+    }
+    return count;
+}
+
+
+bool Tokenizer::atEnd() const
+{
+    return m_rest.empty();
+}
+
+
+void Tokenizer::skipSpaces()
+{
+    std::size_t count = 0;
+    while (count < m_rest.size() && isSpace(m_rest[count]))
+        ++count;
+    m_rest.remove_prefix(count);
+}
@@ -1,7 +1,13 @@
 #include "Transpose.h"
 
 
-Operation::T Transpose::compute(const std::vector<T>& input) const
+Transpose::Transpose()
+    : UnaryOperation(OperationKind::Transpose)
+{
+}
+
+
+Operation::Result Transpose::tryCompute(std::span<const T> input) const
 {
     return input.front().Transpose();
 }
@@ -1,12 +1,7 @@
 #include "UnaryOperation.h"
 
 
-UnaryOperation::UnaryOperation()
+UnaryOperation::UnaryOperation(OperationKind kind, std::int64_t parameter)
+    : Operation(NodeInfo::leaf(kind, parameter))
 {
 }
-
-
-int UnaryOperation::inputCount() const
-{
-	return 1;
-}
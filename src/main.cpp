@@ -1,13 +1,94 @@
 #include "FunctionCalculator.h"
+#include "ScriptEngine.h"
+#include "CalculatorServer.h"
+#include "Tokenizer.h"
 
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <stdexcept>
 
+namespace
+{
+    constexpr auto USAGE = "Usage: oop2_ex03 [--script path [--on-error abort|skip|collect] | --serve socket_path|-]"
+        " [--max-functions n] [--max-size n]";
+
+    // Headless mode: runs the script without prompts, results go to std::cout,
+    // errors and the summary to std::cerr
+    int runScript(const std::string& path, ErrorPolicy policy, int maxFunctions, int maxMatrixSize)
+    {
+        std::ios::sync_with_stdio(false);
+
+        auto calculator = FunctionCalculator(std::cin, std::cout);
+        calculator.setMaxFunctions(maxFunctions);
+        calculator.setMaxMatrixSize(maxMatrixSize);
+        auto engine = ScriptEngine(calculator, policy, std::cerr);
+        const auto report = engine.runFile(path);
+        std::cout.flush();
 
-int main()
+        for (const auto& error : report.errors)
+            std::cerr << "Error (line " << error.line << "): " << error.message << '\n';
+        std::cerr << "Script " << path << ": " << report << '\n';
+        return report.failed == 0 ? 0 : 1;
+    }
+
+    // Server mode: "-" serves a single client over std::cin / std::cout
+    int runServer(const std::string& path, int maxFunctions, int maxMatrixSize)
+    {
+        auto server = CalculatorServer(maxFunctions, maxMatrixSize);
+        if (path == "-")
+            server.serveStream(std::cin, std::cout);
+        else
+            server.serveSocket(path);
+        std::cerr << server.latencyReport();
+        return 0;
+    }
+}
+
+
+int main(int argc, char* argv[])
 {
     try {
-        FunctionCalculator(std::cin, std::cout).run();
+        auto scriptPath = std::string();
+        auto socketPath = std::string();
+        auto policy = ErrorPolicy::Abort;
+        auto maxFunctions = FunctionCalculator::MAX_FUNCTIONS_LIMIT;
+        auto maxMatrixSize = MAX_MAT_SIZE;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const auto arg = std::string_view(argv[i]);
+            const auto value = i + 1 < argc ? std::string_view(argv[i + 1]) : std::string_view();
+            if (arg == "--script" && !value.empty())
+                scriptPath = value;
+            else if (arg == "--serve" && !value.empty())
+                socketPath = value;
+            else if (arg == "--on-error" && parseErrorPolicy(value))
+                policy = *parseErrorPolicy(value);
+            else if (const auto number = Tokenizer(value).nextInt(); arg == "--max-functions" && number)
+                maxFunctions = *number;
+            else if (arg == "--max-size" && number)
+                maxMatrixSize = *number;
+            else
+            {
+                std::cerr << USAGE << std::endl;
+                return 2;
+            }
+            ++i;
+        }
+
+        if (!scriptPath.empty() && !socketPath.empty())
+        {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+        if (!socketPath.empty())
+            return runServer(socketPath, maxFunctions, maxMatrixSize);
+        if (!scriptPath.empty())
+            return runScript(scriptPath, policy, maxFunctions, maxMatrixSize);
+        auto calculator = FunctionCalculator(std::cin, std::cout);
+        calculator.setMaxMatrixSize(maxMatrixSize);
+        calculator.run();
     }
     catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
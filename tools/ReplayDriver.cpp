@@ -0,0 +1,165 @@
+#include "ReplayDriver.h"
+#include "FunctionCalculator.h"
+#include "MappedFile.h"
+#include "Tokenizer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <streambuf>
+#include <chrono>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+namespace
+{
+    struct Percentile
+    {
+        std::string_view label;
+        double fraction;
+    };
+    constexpr Percentile PERCENTILES[] = { { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p99.9", 0.999 } };
+
+    // Accepts and drops everything written to it
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    void printLatencyRow(std::ostream& ostr, std::string_view name, const LatencyHistogram& latency)
+    {
+        ostr << std::left << std::setw(10) << name << std::right << std::setw(10) << latency.count();
+        for (const auto& percentile : PERCENTILES)
+            ostr << std::setw(12) << std::chrono::duration<double, std::micro>(latency.percentile(percentile.fraction)).count();
+        ostr << '\n';
+    }
+}
+
+
+std::uint64_t peakRssBytes()
+{
+#ifdef _WIN32
+    auto counters = PROCESS_MEMORY_COUNTERS();
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    auto usage = rusage();
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#endif
+}
+
+std::ostream& operator<<(std::ostream& ostr, const ReplayReport& report)
+{
+    ostr << report.commands << " commands in " << report.seconds * 1000 << " ms";
+    if (report.seconds > 0)
+        ostr << " (" << static_cast<long long>(report.commandsPerSecond()) << " commands/s)";
+    ostr << ", " << report.failed << " failed\n";
+
+    const auto flags = ostr.flags();
+    const auto precision = ostr.precision();
+    ostr << std::fixed << std::setprecision(2)
+        << std::left << std::setw(10) << "command" << std::right << std::setw(10) << "count";
+    for (const auto& percentile : PERCENTILES)
+        ostr << std::setw(12) << percentile.label;
+    ostr << "  (us)\n";
+    printLatencyRow(ostr, "all", *report.latency);
+    for (const auto& [name, latency] : report.commandLatency)
+        printLatencyRow(ostr, name, *latency);
+    ostr << "peak RSS " << static_cast<double>(report.peakRssBytes) / (1024 * 1024) << " MB\n";
+    ostr.flags(flags);
+    ostr.precision(precision);
+    return ostr;
+}
+
+
+ReplayDriver::ReplayDriver(ErrorPolicy policy, std::ostream& errors)
+    : m_policy(policy), m_errors(errors)
+{
+}
+
+ReplayReport ReplayDriver::replay(const std::string& path, int repetitions, int warmups)
+{
+    const auto file = MappedFile(path);
+    auto report = ReplayReport();
+
+    for (int i = 0; i < warmups; ++i)
+        if (!replayOnce(file.contents(), nullptr))
+            return report;
+    for (int i = 0; i < repetitions; ++i)
+        if (!replayOnce(file.contents(), &report))
+            break;
+
+    report.peakRssBytes = peakRssBytes();
+    return report;
+}
+
+bool ReplayDriver::replayOnce(std::string_view script, ReplayReport* report)
+{
+    auto discard = NullBuffer();
+    auto output = std::ostream(&discard);
+    auto input = std::istream(nullptr);
+    auto calculator = FunctionCalculator(input, output);
+    calculator.setInteractive(false);
+    // Generated scripts may use any size the generator accepts
+    calculator.setMaxMatrixSize(FunctionCalculator::MAX_MAT_SIZE_LIMIT);
+
+    bool stopped = false;
+    const auto fail = [&](std::size_t lineNumber, const auto& error)
+    {
+        if (report)
+            ++report->failed;
+        if (m_policy != ErrorPolicy::Collect)
+            m_errors << "Error (line " << lineNumber << "): " << error << '\n';
+        stopped = m_policy == ErrorPolicy::Abort;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    ScriptEngine::forEachLine(script, [&](std::string_view line, std::size_t lineNumber)
+        {
+            auto args = Tokenizer(line);
+            const auto command = args.next();
+            if (command.empty())
+                return true;
+
+            const auto commandStart = std::chrono::steady_clock::now();
+            try {
+                if (auto result = calculator.executeSingleCommand(line); !result)
+                    fail(lineNumber, result.error());
+            }
+            catch (const std::exception& e) {
+                fail(lineNumber, e.what());
+            }
+            if (!report)
+                return !stopped && calculator.isRunning();
+
+            const auto latency = std::chrono::steady_clock::now() - commandStart;
+            ++report->commands;
+            report->latency->record(latency);
+            auto found = report->commandLatency.find(command);
+            if (found == report->commandLatency.end())
+                found = report->commandLatency.emplace(std::string(command), std::make_unique<LatencyHistogram>()).first;
+            found->second->record(latency);
+            return !stopped && calculator.isRunning();
+        });
+
+    if (report)
+        report->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return !stopped;
+}
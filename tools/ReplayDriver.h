@@ -0,0 +1,54 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "ScriptEngine.h"
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <memory>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+
+// Outcome of replaying a script, over all repetitions
+struct ReplayReport
+{
+    std::size_t commands = 0;
+    std::size_t failed = 0;
+    double seconds = 0;
+    // Latency of every command, and per command name
+    std::unique_ptr<LatencyHistogram> latency = std::make_unique<LatencyHistogram>();
+    std::map<std::string, std::unique_ptr<LatencyHistogram>, std::less<>> commandLatency;
+    std::uint64_t peakRssBytes = 0;
+
+    double commandsPerSecond() const { return seconds > 0 ? static_cast<double>(commands) / seconds : 0; }
+};
+
+// Prints the throughput, a table of latency percentiles and the peak RSS
+std::ostream& operator<<(std::ostream& ostr, const ReplayReport& report);
+
+// Peak resident set size of this process so far, 0 when the platform does not report it
+std::uint64_t peakRssBytes();
+
+
+// Replays a script like the 'read' command, each repetition on a fresh
+// non-interactive calculator, and times every command
+// The calculator output is formatted as usual and then discarded, so it is
+// part of the measured cost without the cost of writing it anywhere
+class ReplayDriver
+{
+public:
+    ReplayDriver(ErrorPolicy policy, std::ostream& errors);
+
+    // Warm-up repetitions run the script without being measured
+    ReplayReport replay(const std::string& path, int repetitions, int warmups = 0);
+
+private:
+    ErrorPolicy m_policy;
+    std::ostream& m_errors;
+
+    // Returns false when the policy stops the script
+    bool replayOnce(std::string_view script, ReplayReport* report);
+};
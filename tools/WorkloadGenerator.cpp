@@ -0,0 +1,156 @@
+#include "WorkloadGenerator.h"
+#include "SquareMatrix.h"
+#include "FunctionCalculator.h"
+
+#include <iostream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+
+
+namespace
+{
+    constexpr int MAX_DEPTH = 64;
+    constexpr int SCALAR_RANGE = 3;
+    constexpr double NORMAL_DEVIATION = 100;
+    constexpr int SMALL_RANGE = 9;
+    // Percent of edge values drawn from the bounds, the rest are small
+    constexpr int EDGE_PERCENT = 80;
+    constexpr int DEFAULT_MAX_FUNCTIONS = 100;
+    // Functions 0 and 1 are built in, generated functions are numbered from here
+    constexpr std::int64_t FIRST_ID = 2;
+
+    struct Function
+    {
+        std::int64_t id;
+        std::int64_t inputs; // input matrices an evaluation takes, saturated at maxInputs + 1
+    };
+
+    int drawValue(ValueDistribution distribution, std::mt19937& random)
+    {
+        switch (distribution)
+        {
+        case ValueDistribution::Small:
+            return std::uniform_int_distribution<int>(-SMALL_RANGE, SMALL_RANGE)(random);
+        case ValueDistribution::Uniform:
+            return std::uniform_int_distribution<int>(MIN_ALLOWED_VALUE, MAX_ALLOWED_VALUE)(random);
+        case ValueDistribution::Normal:
+        {
+            const auto value = std::lround(std::normal_distribution<double>(0, NORMAL_DEVIATION)(random));
+            return static_cast<int>(std::clamp<long>(value, MIN_ALLOWED_VALUE, MAX_ALLOWED_VALUE));
+        }
+        case ValueDistribution::Edge:
+            if (std::uniform_int_distribution<int>(0, 99)(random) >= EDGE_PERCENT)
+                return std::uniform_int_distribution<int>(-SMALL_RANGE, SMALL_RANGE)(random);
+            return std::bernoulli_distribution()(random) ? MAX_ALLOWED_VALUE : MIN_ALLOWED_VALUE;
+        }
+        return 0;
+    }
+}
+
+
+std::optional<ValueDistribution> parseValueDistribution(std::string_view name)
+{
+    if (name == "small")
+        return ValueDistribution::Small;
+    if (name == "uniform")
+        return ValueDistribution::Uniform;
+    if (name == "normal")
+        return ValueDistribution::Normal;
+    if (name == "edge")
+        return ValueDistribution::Edge;
+    return {};
+}
+
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadOptions& options)
+    : m_options(options)
+{
+    if (options.depth < 0 || options.depth > MAX_DEPTH)
+        throw std::invalid_argument("Depth must be between 0 and " + std::to_string(MAX_DEPTH));
+    if (options.width < 1)
+        throw std::invalid_argument("Width must be at least 1");
+    if (static_cast<std::int64_t>(options.width) * (options.depth + 1) >= FunctionCalculator::MAX_FUNCTIONS_LIMIT - FIRST_ID)
+        throw std::invalid_argument("Too many functions, at most " + std::to_string(FunctionCalculator::MAX_FUNCTIONS_LIMIT)
+            + " can be stored");
+    if (options.sharing < 0 || options.sharing > 100)
+        throw std::invalid_argument("Sharing must be between 0 and 100");
+    if (options.evals < 0)
+        throw std::invalid_argument("Evaluation count must not be negative");
+    if (options.size <= 1 || options.size > FunctionCalculator::MAX_MAT_SIZE_LIMIT)
+        throw std::invalid_argument("Matrix size must be between 2 and " + std::to_string(FunctionCalculator::MAX_MAT_SIZE_LIMIT));
+    if (options.maxInputs < 1)
+        throw std::invalid_argument("Maximum input count must be at least 1");
+    if (options.kinds.empty())
+        throw std::invalid_argument("Expected at least one function kind");
+    for (const auto& kind : options.kinds)
+        if (kind != "add" && kind != "sub" && kind != "comp")
+            throw std::invalid_argument("Unknown function kind: " + kind + " (expected add, sub or comp)");
+}
+
+void WorkloadGenerator::write(std::ostream& ostr) const
+{
+    auto random = std::mt19937(m_options.seed);
+    const auto width = static_cast<std::size_t>(m_options.width);
+    const auto inputLimit = static_cast<std::int64_t>(m_options.maxInputs) + 1;
+
+    // 'eval' refuses to run on a full function list, so one slot stays free
+    const auto total = FIRST_ID + static_cast<std::int64_t>(m_options.width) * (m_options.depth + 1) + 1;
+    ostr << "resize " << std::max<std::int64_t>(total, DEFAULT_MAX_FUNCTIONS) << '\n';
+
+    auto functions = std::vector<Function>();
+    auto nextId = FIRST_ID;
+    for (std::size_t i = 0; i < width; ++i)
+    {
+        ostr << "scal " << std::uniform_int_distribution<int>(-SCALAR_RANGE, SCALAR_RANGE)(random) << '\n';
+        functions.push_back({ nextId++, 1 });
+    }
+
+    for (int level = 1; level <= m_options.depth; ++level)
+    {
+        const auto below = functions.end() - static_cast<std::ptrdiff_t>(width);
+        // Children are taken round robin from a random start, unless a taken one is shared
+        auto next = std::uniform_int_distribution<std::size_t>(0, width - 1)(random);
+        auto taken = std::vector<std::size_t>();
+        const auto child = [&]
+            {
+                if (!taken.empty() && std::uniform_int_distribution<int>(0, 99)(random) < m_options.sharing)
+                    return taken[std::uniform_int_distribution<std::size_t>(0, taken.size() - 1)(random)];
+                taken.push_back(next);
+                next = (next + 1) % width;
+                return taken.back();
+            };
+
+        auto levelFunctions = std::vector<Function>();
+        for (std::size_t i = 0; i < width; ++i)
+        {
+            const auto& kind = m_options.kinds[std::uniform_int_distribution<std::size_t>(0, m_options.kinds.size() - 1)(random)];
+            const auto& first = below[static_cast<std::ptrdiff_t>(child())];
+            const auto& second = below[static_cast<std::ptrdiff_t>(child())];
+            ostr << kind << ' ' << first.id << ' ' << second.id << '\n';
+
+            const auto inputs = first.inputs + second.inputs - (kind == "comp" ? 1 : 0);
+            levelFunctions.push_back({ nextId++, std::min(inputs, inputLimit) });
+        }
+        functions.insert(functions.end(), levelFunctions.begin(), levelFunctions.end());
+    }
+
+    auto candidates = std::vector<Function>();
+    std::copy_if(functions.begin(), functions.end(), std::back_inserter(candidates),
+        [&](const Function& function) { return function.inputs < inputLimit; });
+    if (m_options.evals > 0 && candidates.empty())
+        throw std::invalid_argument("No function takes at most " + std::to_string(m_options.maxInputs) + " input matrices");
+
+    const auto valuesPerMatrix = m_options.size * m_options.size;
+    for (int i = 0; i < m_options.evals; ++i)
+    {
+        const auto& function = candidates[std::uniform_int_distribution<std::size_t>(0, candidates.size() - 1)(random)];
+        ostr << "eval " << function.id << ' ' << m_options.size;
+        for (std::int64_t value = 0; value < function.inputs * valuesPerMatrix; ++value)
+            ostr << ' ' << drawValue(m_options.values, random);
+        ostr << '\n';
+    }
+}
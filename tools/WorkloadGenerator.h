@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <iosfwd>
+#include <cstdint>
+
+
+// How the values of the generated input matrices are drawn
+enum class ValueDistribution
+{
+    Small,   // uniform in [-9, 9], results mostly stay in range
+    Uniform, // uniform in [MIN_ALLOWED_VALUE, MAX_ALLOWED_VALUE]
+    Normal,  // around 0 with a standard deviation of 100, clamped to the allowed range
+    Edge,    // mostly the bounds of the allowed range, most evaluations overflow
+};
+
+// Accepts "small", "uniform", "normal" or "edge"
+std::optional<ValueDistribution> parseValueDistribution(std::string_view name);
+
+struct WorkloadOptions
+{
+    std::uint32_t seed = 1;
+    int depth = 4;          // levels of functions above the scal leaves
+    int width = 16;         // functions per level
+    int sharing = 0;        // percent of children that reuse a child already taken on the same level
+    int evals = 1000;
+    int size = 3;           // matrix size of the evaluations
+    int maxInputs = 64;     // functions taking more input matrices are not evaluated
+    ValueDistribution values = ValueDistribution::Small;
+    std::vector<std::string> kinds = { "add", "sub", "comp" }; // commands of the upper levels
+};
+
+// Writes a seeded random script in the format of the 'read' command
+// Level 0 holds 'width' scal functions, and every function of level l
+// combines two functions of level l - 1 with one of the given kinds, so
+// every function of the top level is exactly 'depth' levels deep
+// With sharing 0 the children of a level are spread evenly over the level
+// below, with sharing 100 every function of a level reuses the same child,
+// so the DAG stays small while its tree grows exponentially
+// The script starts with a 'resize' that makes room for all functions,
+// followed by the definitions and then the evaluations
+class WorkloadGenerator
+{
+public:
+    // Throws std::invalid_argument for options out of range
+    explicit WorkloadGenerator(const WorkloadOptions& options);
+
+    void write(std::ostream& ostr) const;
+
+private:
+    WorkloadOptions m_options;
+};
@@ -0,0 +1,149 @@
+#include "WorkloadGenerator.h"
+#include "ReplayDriver.h"
+#include "Tokenizer.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr auto USAGE =
+        "Usage: oop2_ex03_workload generate [--seed n] [--depth n] [--width n] [--sharing percent] [--evals n]\n"
+        "           [--size n] [--max-inputs n] [--values small|uniform|normal|edge] [--kinds add,sub,comp]\n"
+        "           [--output path]\n"
+        "       oop2_ex03_workload replay script_path [--repeat n] [--warmup n] [--on-error abort|skip|collect]";
+
+    // Splits "add,sub" into its names
+    std::vector<std::string> splitList(std::string_view list)
+    {
+        auto names = std::vector<std::string>();
+        for (std::size_t start = 0; start <= list.size();)
+        {
+            const auto end = std::min(list.find(',', start), list.size());
+            names.emplace_back(list.substr(start, end - start));
+            start = end + 1;
+        }
+        return names;
+    }
+
+    int generate(int argc, char* argv[])
+    {
+        auto options = WorkloadOptions();
+        auto outputPath = std::string();
+
+        for (int i = 2; i < argc; i += 2)
+        {
+            const auto arg = std::string_view(argv[i]);
+            const auto value = std::string_view(i + 1 < argc ? argv[i + 1] : "");
+            const auto number = Tokenizer(value).nextInt();
+            const auto values = parseValueDistribution(value);
+            if (arg == "--output" && !value.empty())
+                outputPath = value;
+            else if (arg == "--values" && values)
+                options.values = *values;
+            else if (arg == "--kinds" && !value.empty())
+                options.kinds = splitList(value);
+            else if (!number)
+            {
+                std::cerr << USAGE << std::endl;
+                return 2;
+            }
+            else if (arg == "--seed" && *number >= 0)
+                options.seed = static_cast<std::uint32_t>(*number);
+            else if (arg == "--depth")
+                options.depth = *number;
+            else if (arg == "--width")
+                options.width = *number;
+            else if (arg == "--sharing")
+                options.sharing = *number;
+            else if (arg == "--evals")
+                options.evals = *number;
+            else if (arg == "--size")
+                options.size = *number;
+            else if (arg == "--max-inputs")
+                options.maxInputs = *number;
+            else
+            {
+                std::cerr << USAGE << std::endl;
+                return 2;
+            }
+        }
+
+        const auto generator = WorkloadGenerator(options);
+        if (outputPath.empty())
+        {
+            std::ios::sync_with_stdio(false);
+            generator.write(std::cout);
+            return 0;
+        }
+
+        auto file = std::ofstream(outputPath);
+        if (!file)
+            throw std::invalid_argument("Failed to open file: " + outputPath);
+        generator.write(file);
+        return 0;
+    }
+
+    int replay(int argc, char* argv[])
+    {
+        if (argc < 3)
+        {
+            std::cerr << USAGE << std::endl;
+            return 2;
+        }
+
+        const auto path = std::string(argv[2]);
+        auto policy = ErrorPolicy::Skip;
+        int repetitions = 1;
+        int warmups = 0;
+
+        for (int i = 3; i < argc; i += 2)
+        {
+            const auto arg = std::string_view(argv[i]);
+            const auto value = std::string_view(i + 1 < argc ? argv[i + 1] : "");
+            const auto number = Tokenizer(value).nextInt();
+            const auto parsedPolicy = parseErrorPolicy(value);
+            if (arg == "--repeat" && number && *number > 0)
+                repetitions = *number;
+            else if (arg == "--warmup" && number && *number >= 0)
+                warmups = *number;
+            else if (arg == "--on-error" && parsedPolicy)
+                policy = *parsedPolicy;
+            else
+            {
+                std::cerr << USAGE << std::endl;
+                return 2;
+            }
+        }
+
+        auto driver = ReplayDriver(policy, std::cerr);
+        const auto report = driver.replay(path, repetitions, warmups);
+        std::cout << "Replayed " << path << ": " << report;
+        return report.failed == 0 ? 0 : 1;
+    }
+}
+
+
+// Generates seeded workload scripts, and replays scripts to measure the calculator
+// Exits with 2 on a usage error, and replay exits with 1 when a command failed
+int main(int argc, char* argv[])
+{
+    try {
+        const auto mode = std::string_view(argc > 1 ? argv[1] : "");
+        if (mode == "generate")
+            return generate(argc, argv);
+        if (mode == "replay")
+            return replay(argc, argv);
+        std::cerr << USAGE << std::endl;
+        return 2;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}